@@ -1,226 +1,187 @@
 #include <iostream>
 #include <chrono>
+#include <random>
 #include "RSA.hpp"
+#include "Harness.hpp"
 
-template <class vec, class ostr>
-ostr& operator<<(ostr& out, std::vector<vec> _vec) {
-	for (uint64_t i = 0; i < _vec.size() - 1; ++i) {
-		out << _vec.at(i);
-	}
-	return out << _vec.back();
-}
+// The backend is the RSA.hpp found first on the include path, build once with -IGMP and once with -IBoost
+#ifdef __GMP_PLUSPLUS__
+	constexpr const char* backend = "gmp";
+#else
+	constexpr const char* backend = "boost";
+#endif
 
-class Timer
+// "1024,2048" -> { 1024, 2048 }, sizes can end with K or M
+std::vector<uint64_t> parse_list(const std::string& _list)
 {
-private:
-	bool m_Out = true;
-	const char* m_Name = "Timer";
-
-public:
+	std::vector<uint64_t> values;
+	size_t begin = 0;
 
-	std::chrono::time_point<std::chrono::steady_clock>
-		start = std::chrono::high_resolution_clock::now(),
-		end;
-	std::chrono::duration<float> duration{};
-
-	Timer() = default;
+	while (begin < _list.size())
+	{
+		size_t end = _list.find(',', begin);
+		end = (end == std::string::npos) ? _list.size() : end;
 
-	Timer(const char* _Name) : m_Name(_Name) {}
+		char* suffix = nullptr;
+		uint64_t value = std::strtoull(_list.c_str() + begin, &suffix, 10);
 
-	~Timer()
-	{
-		if (m_Out) {
-			end = std::chrono::high_resolution_clock::now();
-			duration = end - start;
+		if (*suffix == 'K' || *suffix == 'k') {
+			value *= 1024;
+		}
+		else if (*suffix == 'M' || *suffix == 'm') {
+			value *= 1024 * 1024;
+		}
 
-			float ms = duration.count() * 1000.F;
-			std::cout << m_Name << " took: " << ms << "ms\n";
+		if (value != 0) {
+			values.push_back(value);
 		}
-	}
 
-	void toggle_output()
-	{
-		m_Out = !m_Out;
+		begin = end + 1;
 	}
-};
 
-template <class Time = std::chrono::milliseconds>
-class Benchmark
-{
-public:
+	return values;
+}
 
-	template <class Fn, class... Args>
-	explicit Benchmark(Fn&& _Func, Args&&... _Args) {
-		Timer T;
-		try
-		{
-			_Func(_Args...);
-		}
-		catch (const std::exception& ex)
-		{
-			std::cerr << "Benchmark throw: " << ex.what() << "\n";
-			T.toggle_output();
-		}
+std::string format_size(const uint64_t _size)
+{
+	if (_size >= 1024 * 1024 && _size % (1024 * 1024) == 0) {
+		return std::to_string(_size / (1024 * 1024)) + "M";
 	}
-
-	template <class Fn, class... Args>
-	explicit Benchmark(const char* _Name, Fn&& _Func, Args&&... _Args) {
-		Timer T(_Name);
-		try
-		{
-			_Func(_Args...);
-		}
-		catch (const std::exception& ex)
-		{
-			std::cerr << _Name << " throw: " << ex.what() << "\n";
-			T.toggle_output();
-		}
+	if (_size >= 1024 && _size % 1024 == 0) {
+		return std::to_string(_size / 1024) + "K";
 	}
-};
+	return std::to_string(_size);
+}
 
-void test1()
+// Random message of X bytes, wide types also get characters outside of ASCII
+template <class char_type>
+std::basic_string<char_type> random_message(const uint64_t _bytes)
 {
-	std::string_view message = "Hello World!";
-
-	RSA::RSA rsa(256);
-
-	Benchmark(
-		"Generation (256 BIT)",
-		[&rsa]()
-		{
-			rsa.setup();
-		}
-	);
-
-	std::cout << '\n';
+	std::mt19937 gen(42);
+	std::uniform_int_distribution<uint32_t> dist(32, sizeof(char_type) == 1 ? 126 : 0x7ff);
 
-	if (rsa)
-	{
-		std::vector<RSA::number_t> enc;
-
-		Benchmark(
-			"Encryption",
-			[&rsa, &enc, message]()
-			{
-				enc = rsa.encrypt(message, rsa.public_key);
+	std::basic_string<char_type> message(std::max<uint64_t>(_bytes / sizeof(char_type), 1), char_type());
 
-				std::cout << "Encypted: " << enc << '\n';
-			}
-		);
-
-		std::cout << '\n';
-
-		Benchmark(
-			"Decryption",
-			[&rsa, &enc]()
-			{
-				std::cout << "Decypted: " << rsa.decrypt(enc) << '\n';
-			}
-		);
+	for (auto& chr : message) {
+		chr = static_cast<char_type>(dist(gen));
 	}
 
-	std::cout << '\n';
+	return message;
 }
 
-void test2()
+// Encrypt and decrypt every message size with every key size, keys are generated once per key size and not timed
+template <class char_type>
+void bench_matrix(bench::harness& _harness, const char* _char_name, const std::vector<uint64_t>& _keysizes, const std::vector<uint64_t>& _sizes)
 {
-	Benchmark(
-		"Generation of Key (128  BIT)",
-		[]()
-		{
-			RSA::RSA rsa(128);
-			rsa.setup();
-		}
-	);
+	const std::string prefix = std::string(backend) + "/" + _char_name + "/";
 
+	for (const uint64_t keysize : _keysizes)
+	{
+		bool any = false;
 
-	Benchmark(
-		"Generation of Key (256  BIT)",
-		[]()
-		{
-			RSA::RSA rsa(256);
-			rsa.setup();
-		}
-	);
-
-	Benchmark(
-		"Generation of Key (512  BIT)",
-		[]()
-		{
-			RSA::RSA rsa(512);
-			rsa.setup();
+		for (const uint64_t size : _sizes) {
+			const std::string name = prefix + std::to_string(keysize) + "/" + format_size(size);
+			any = any || _harness.selected(name + "/encrypt") || _harness.selected(name + "/decrypt");
 		}
-	);
 
-	Benchmark(
-		"Generation of Key (1024 BIT)",
-		[]()
-		{
-			RSA::RSA rsa(1024);
-			rsa.setup();
+		if (!any) {
+			continue;
 		}
-	);
 
-	Benchmark(
-		"Generation of Key (2048 BIT)",
-		[]()
-		{
-			RSA::RSA rsa(2048);
-			rsa.setup();
-		}
-	);
+		RSA::basic_rsa<char_type, false> rsa(static_cast<uint32_t>(keysize));
+		rsa.setup();
 
-	Benchmark(
-		"Generation of Key (3072 BIT)",
-		[]()
+		for (const uint64_t size : _sizes)
 		{
-			RSA::RSA rsa(3072);
-			rsa.setup();
-		}
-	);
+			const std::string name = prefix + std::to_string(keysize) + "/" + format_size(size);
+			const auto message = random_message<char_type>(size);
+			const uint64_t bytes = message.size() * sizeof(char_type);
 
-	Benchmark(
-		"Generation of Key (4096 BIT)",
-		[]()
-		{
-			RSA::RSA rsa(4096);
-			rsa.setup();
-		}
-	);
+			if (auto* result = _harness.run(name + "/encrypt", [&rsa, &message]() { return rsa.encrypt(message, rsa.public_key); })) {
+				result->bytes = bytes;
+				result->items = rsa.encrypt(message, rsa.public_key).size();
+			}
 
-	Benchmark(
-		"Generation of Key (6144 BIT)",
-		[]()
-		{
-			RSA::RSA rsa(6144);
-			rsa.setup();
-		}
-	);
+			if (!_harness.selected(name + "/decrypt")) {
+				continue;
+			}
 
-	Benchmark(
-		"Generation of Key (8192 BIT)",
-		[]()
-		{
-			RSA::RSA rsa(8192);
-			rsa.setup();
+			const auto encrypted = rsa.encrypt(message, rsa.public_key);
+
+			auto* result = _harness.run(
+				name + "/decrypt",
+				[&encrypted]()
+				{
+					return encrypted;
+				},
+				[&rsa](std::vector<RSA::number_t>& _encrypted)
+				{
+					return rsa.decrypt(_encrypted);
+				}
+			);
+
+			if (result) {
+				result->bytes = bytes;
+				result->items = encrypted.size();
+			}
 		}
-	);
+	}
 }
 
+void bench_keygen(bench::harness& _harness, const std::vector<uint64_t>& _keysizes)
+{
+	for (const uint64_t keysize : _keysizes)
+	{
+		_harness.run(
+			std::string(backend) + "/keygen/" + std::to_string(keysize),
+			[keysize]()
+			{
+				return RSA::RSA(static_cast<uint32_t>(keysize));
+			},
+			[](RSA::RSA& _rsa)
+			{
+				_rsa.setup();
+				return _rsa.setupdone();
+			}
+		);
+	}
+}
 
-int main()
+int main(int argc, char** argv)
 {
-	//Note that these results are RANDOM in therms of time the setuperation can take one millisecond or just 100 second for example.
-	test1();
-	test2();
+	// Key generation times are random, one run can take a millisecond and the next one 100 times longer,
+	// so every case is sampled until --iterations and --time are reached
+	bench::harness harness(argc, argv);
 
-	// Example
+	// --keys, --sizes and --chars select the matrix, e.g. --keys 1024,2048,4096,8192 --sizes 16,1K,64K,1M,64M
+	const auto keysizes = parse_list(harness.option("keys", "1024,2048"));
+	const auto sizes = parse_list(harness.option("sizes", "16,1K,64K"));
+	const std::string chars = "," + harness.option("chars", "char,wchar_t,char8_t,char16_t,char32_t") + ",";
 
-	RSA::RSA rsa;
-	rsa.set_trys(RSA::Auto); // This is just to let u know that there is an Auto mode ( This is Default so you can remove the line )
-	rsa.setup();
+	auto wanted = [&chars](const char* _name)
+	{
+		return chars.find("," + std::string(_name) + ",") != std::string::npos;
+	};
+
+	if (wanted("char")) {
+		bench_matrix<char>(harness, "char", keysizes, sizes);
+	}
+	if (wanted("wchar_t")) {
+		bench_matrix<wchar_t>(harness, "wchar_t", keysizes, sizes);
+	}
+#ifdef __cpp_char8_t
+	if (wanted("char8_t")) {
+		bench_matrix<char8_t>(harness, "char8_t", keysizes, sizes);
+	}
+#endif
+	if (wanted("char16_t")) {
+		bench_matrix<char16_t>(harness, "char16_t", keysizes, sizes);
+	}
+	if (wanted("char32_t")) {
+		bench_matrix<char32_t>(harness, "char32_t", keysizes, sizes);
+	}
 
-	std::cout << rsa;
+	bench_keygen(harness, parse_list(harness.option("keygen", "128,256,512,1024,2048")));
 
-	std::cin.get();
+	return harness.report();
 }
@@ -0,0 +1,747 @@
+#pragma once
+
+#ifndef _RSA_BENCH_HARNESS_
+#define _RSA_BENCH_HARNESS_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "PerfCounters.hpp"
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+namespace bench
+{
+	// Keep the compiler from removing a computation whose result is never used
+	template <class T>
+	inline void do_not_optimize(T&& _value)
+	{
+#ifdef _MSC_VER
+		static volatile const void* sink;
+		sink = &_value;
+		_ReadWriteBarrier();
+#else
+		asm volatile("" : : "r,m"(_value) : "memory");
+#endif
+	}
+
+	struct options
+	{
+		uint32_t warmup = 1;          // Untimed runs before sampling
+		uint32_t min_iterations = 5;  // Samples taken even if the time budget is used up
+		uint32_t max_iterations = 1000;
+		double time_budget = 1.0;     // Seconds of sampling per case
+		std::string filter;           // Only run cases containing this
+		std::string json;             // Write results as JSON to this file
+		std::string csv;              // Write results as CSV to this file
+		bool counters = false;        // Capture hardware counters around every sample
+		std::string save_baseline;    // Save results with their samples as baseline to this file
+		std::string baseline;         // Compare against the baseline in this file
+		double threshold = 5.0;       // Median slowdown in percent that fails the run when it is significant
+		double alpha = 0.01;          // Significance level of the Mann-Whitney U test
+
+		// Options the harness doesn`t know, for the benchmark itself
+		std::vector<std::pair<std::string, std::string>> extra;
+	};
+
+	struct stats
+	{
+		size_t samples = 0;
+		double min = 0, median = 0, mean = 0, p90 = 0, p99 = 0, stddev = 0, max = 0;
+
+		// Summary of samples in nanoseconds
+		static stats compute(std::vector<double> _samples)
+		{
+			stats result;
+
+			if (_samples.empty()) {
+				return result;
+			}
+
+			std::sort(_samples.begin(), _samples.end());
+
+			double sum = 0;
+
+			for (const double sample : _samples) {
+				sum += sample;
+			}
+
+			result.samples = _samples.size();
+			result.min = _samples.front();
+			result.max = _samples.back();
+			result.mean = sum / _samples.size();
+			result.median = percentile(_samples, 0.5);
+			result.p90 = percentile(_samples, 0.9);
+			result.p99 = percentile(_samples, 0.99);
+
+			double square = 0;
+
+			for (const double sample : _samples) {
+				square += (sample - result.mean) * (sample - result.mean);
+			}
+
+			result.stddev = _samples.size() > 1 ? std::sqrt(square / (_samples.size() - 1)) : 0;
+
+			return result;
+		}
+
+		// Linear interpolation between the closest ranks of sorted samples
+		static double percentile(const std::vector<double>& _sorted, const double _p)
+		{
+			const double rank = _p * (_sorted.size() - 1);
+			const size_t low = static_cast<size_t>(rank);
+			const size_t high = std::min(low + 1, _sorted.size() - 1);
+
+			return _sorted[low] + (_sorted[high] - _sorted[low]) * (rank - low);
+		}
+	};
+
+	struct result
+	{
+		std::string name;
+		std::vector<double> samples;  // Nanoseconds per iteration
+		stats summary;
+		uint64_t bytes = 0;           // Bytes processed per iteration
+		uint64_t items = 0;           // Items (e.g. blocks) processed per iteration
+
+		// Hardware counters per iteration, only the available ones
+		std::vector<std::pair<std::string, double>> counters;
+
+		// Throughput at the median time
+		double mb_per_second() const noexcept
+		{
+			return summary.median > 0 ? bytes / summary.median * 1e9 / (1024 * 1024) : 0;
+		}
+
+		double items_per_second() const noexcept
+		{
+			return summary.median > 0 ? items / summary.median * 1e9 : 0;
+		}
+
+		double ns_per_item() const noexcept
+		{
+			return items > 0 ? summary.median / items : 0;
+		}
+	};
+
+	class harness
+	{
+	private:
+		options m_options;
+		std::vector<result> m_results;
+		std::unique_ptr<perf_counters> m_counters;
+
+		// Counter values before and after a sample and their sums over all samples of a case
+		std::vector<double> m_before, m_after, m_totals;
+
+		using clock = std::chrono::steady_clock;
+
+	public:
+		harness() = default;
+
+		explicit harness(const options& _options) : m_options(_options)
+		{
+			open_counters();
+		}
+
+		// Parse --warmup N, --iterations N, --max-iterations N, --time S, --filter X, --json FILE, --csv FILE, --counters,
+		// --save-baseline FILE, --baseline FILE, --threshold PERCENT, --alpha P,
+		// any other --name value pair is kept for option()
+		harness(const int _argc, const char* const* _argv)
+		{
+			for (int i = 1; i < _argc; ++i)
+			{
+				const std::string_view arg = _argv[i];
+				const char* value = (i + 1 < _argc) ? _argv[i + 1] : nullptr;
+
+				if (arg == "--counters") {
+					m_options.counters = true;
+					continue;
+				}
+
+				if (value == nullptr) {
+					std::cerr << "Missing value for " << arg << "\n";
+					break;
+				}
+
+				if (arg == "--warmup") {
+					m_options.warmup = std::strtoul(value, nullptr, 10);
+				}
+				else if (arg == "--iterations") {
+					m_options.min_iterations = std::strtoul(value, nullptr, 10);
+				}
+				else if (arg == "--max-iterations") {
+					m_options.max_iterations = std::strtoul(value, nullptr, 10);
+				}
+				else if (arg == "--time") {
+					m_options.time_budget = std::strtod(value, nullptr);
+				}
+				else if (arg == "--filter") {
+					m_options.filter = value;
+				}
+				else if (arg == "--json") {
+					m_options.json = value;
+				}
+				else if (arg == "--csv") {
+					m_options.csv = value;
+				}
+				else if (arg == "--save-baseline") {
+					m_options.save_baseline = value;
+				}
+				else if (arg == "--baseline") {
+					m_options.baseline = value;
+				}
+				else if (arg == "--threshold") {
+					m_options.threshold = std::strtod(value, nullptr);
+				}
+				else if (arg == "--alpha") {
+					m_options.alpha = std::strtod(value, nullptr);
+				}
+				else {
+					m_options.extra.emplace_back(std::string(arg.substr(arg.find_first_not_of('-'))), value);
+				}
+
+				++i;
+			}
+
+			m_options.max_iterations = std::max(m_options.max_iterations, m_options.min_iterations);
+
+			open_counters();
+		}
+
+		const options& config() const noexcept
+		{
+			return m_options;
+		}
+
+		const std::vector<result>& results() const noexcept
+		{
+			return m_results;
+		}
+
+		// Value of an option the harness doesn`t know, e.g. "keys" for --keys
+		std::string option(const std::string_view& _name, const std::string_view& _default = { }) const
+		{
+			for (const auto& [name, value] : m_options.extra) {
+				if (name == _name) {
+					return value;
+				}
+			}
+
+			return std::string(_default);
+		}
+
+		// True if a case with this name is selected by --filter
+		bool selected(const std::string_view& _name) const noexcept
+		{
+			return m_options.filter.empty() || _name.find(m_options.filter) != std::string_view::npos;
+		}
+
+		// Time fn(), only the call itself is measured, the result is null if the case is skipped or throws
+		template <class Fn>
+		result* run(const std::string_view& _name, Fn&& _fn)
+		{
+			return run(_name, []() { return 0; }, [&_fn](int) { return _fn(); });
+		}
+
+		// Time fn(setup()), setup() prepares untimed input for every iteration (e.g. a copy that fn consumes)
+		template <class Setup, class Fn>
+		result* run(const std::string_view& _name, Setup&& _setup, Fn&& _fn)
+		{
+			if (!selected(_name)) {
+				return nullptr;
+			}
+
+			try
+			{
+				for (uint32_t i = 0; i < m_options.warmup; ++i) {
+					auto input = _setup();
+					measure(_fn, input);
+				}
+
+				result current;
+				current.name = _name;
+
+				if (m_counters) {
+					m_totals.assign(m_counters->size(), 0);
+				}
+
+				const auto budget = std::chrono::duration<double>(m_options.time_budget);
+				const auto begin = clock::now();
+
+				while (current.samples.size() < m_options.max_iterations)
+				{
+					if (current.samples.size() >= m_options.min_iterations && clock::now() - begin >= budget) {
+						break;
+					}
+
+					auto input = _setup();
+
+					if (m_counters) {
+						m_counters->read(m_before);
+					}
+
+					current.samples.push_back(measure(_fn, input));
+
+					if (m_counters)
+					{
+						m_counters->read(m_after);
+
+						for (size_t i = 0; i < m_totals.size(); ++i) {
+							m_totals[i] += m_after[i] - m_before[i];
+						}
+					}
+				}
+
+				current.summary = stats::compute(current.samples);
+
+				for (size_t i = 0; m_counters && i < m_counters->size(); ++i) {
+					if (m_counters->available(i)) {
+						current.counters.emplace_back(m_counters->name(i), m_totals[i] / current.samples.size());
+					}
+				}
+				m_results.push_back(std::move(current));
+
+				return &m_results.back();
+			}
+			catch (const std::exception& ex)
+			{
+				std::cerr << _name << " throw: " << ex.what() << "\n";
+			}
+
+			return nullptr;
+		}
+
+		// Human readable table of all results
+		void print(std::ostream& _out) const
+		{
+			_out << std::left << std::setw(40) << "case" << std::right
+				<< std::setw(8) << "n"
+				<< std::setw(14) << "min"
+				<< std::setw(14) << "median"
+				<< std::setw(14) << "mean"
+				<< std::setw(14) << "p90"
+				<< std::setw(14) << "p99"
+				<< std::setw(14) << "stddev"
+				<< std::setw(12) << "MB/s"
+				<< std::setw(14) << "items/s"
+				<< std::setw(14) << "per item" << "\n";
+
+			for (const auto& result : m_results)
+			{
+				const auto& s = result.summary;
+
+				_out << std::left << std::setw(40) << result.name << std::right
+					<< std::setw(8) << s.samples
+					<< std::setw(14) << format_time(s.min)
+					<< std::setw(14) << format_time(s.median)
+					<< std::setw(14) << format_time(s.mean)
+					<< std::setw(14) << format_time(s.p90)
+					<< std::setw(14) << format_time(s.p99)
+					<< std::setw(14) << format_time(s.stddev);
+
+				if (result.bytes != 0) {
+					_out << std::setw(12) << std::fixed << std::setprecision(2) << result.mb_per_second() << std::defaultfloat;
+				}
+				else {
+					_out << std::setw(12) << "-";
+				}
+
+				if (result.items != 0) {
+					_out << std::setw(14) << std::fixed << std::setprecision(0) << result.items_per_second() << std::defaultfloat
+						<< std::setw(14) << format_time(result.ns_per_item());
+				}
+				else {
+					_out << std::setw(14) << "-" << std::setw(14) << "-";
+				}
+
+				_out << "\n";
+			}
+
+			print_counters(_out);
+		}
+
+		// Counters per iteration and per byte
+		void print_counters(std::ostream& _out) const
+		{
+			const auto first = std::find_if(m_results.begin(), m_results.end(), [](const result& _result) { return !_result.counters.empty(); });
+
+			if (first == m_results.end()) {
+				return;
+			}
+
+			for (const bool per_byte : { false, true })
+			{
+				_out << "\n" << std::left << std::setw(40) << (per_byte ? "counters per byte" : "counters per iteration") << std::right;
+
+				for (const auto& [name, value] : first->counters) {
+					_out << std::setw(18) << name;
+				}
+
+				_out << "\n";
+
+				for (const auto& result : m_results)
+				{
+					if (result.counters.empty() || (per_byte && result.bytes == 0)) {
+						continue;
+					}
+
+					_out << std::left << std::setw(40) << result.name << std::right << std::fixed << std::setprecision(per_byte ? 3 : 0);
+
+					for (const auto& [name, value] : result.counters) {
+						_out << std::setw(18) << (per_byte ? value / result.bytes : value);
+					}
+
+					_out << std::defaultfloat << "\n";
+				}
+			}
+		}
+
+		// All results with their raw samples, times in nanoseconds
+		void write_json(std::ostream& _out) const
+		{
+			_out << std::setprecision(15) << "{\n  \"cases\": [";
+
+			for (size_t i = 0; i < m_results.size(); ++i)
+			{
+				const auto& result = m_results[i];
+				const auto& s = result.summary;
+
+				_out << (i ? ",\n" : "\n") << "    {\"name\": \"" << escape(result.name) << "\""
+					<< ", \"iterations\": " << s.samples
+					<< ", \"min_ns\": " << s.min
+					<< ", \"median_ns\": " << s.median
+					<< ", \"mean_ns\": " << s.mean
+					<< ", \"p90_ns\": " << s.p90
+					<< ", \"p99_ns\": " << s.p99
+					<< ", \"stddev_ns\": " << s.stddev
+					<< ", \"max_ns\": " << s.max
+					<< ", \"bytes\": " << result.bytes
+					<< ", \"items\": " << result.items
+					<< ", \"mb_per_s\": " << result.mb_per_second()
+					<< ", \"items_per_s\": " << result.items_per_second()
+					<< ", \"ns_per_item\": " << result.ns_per_item()
+					<< ", \"counters\": {";
+
+				for (size_t j = 0; j < result.counters.size(); ++j) {
+					_out << (j ? ", " : "") << '"' << result.counters[j].first << "\": " << result.counters[j].second;
+				}
+
+				_out << "}, \"counters_per_byte\": {";
+
+				for (size_t j = 0; result.bytes != 0 && j < result.counters.size(); ++j) {
+					_out << (j ? ", " : "") << '"' << result.counters[j].first << "\": " << result.counters[j].second / result.bytes;
+				}
+
+				_out << "}"
+					<< ", \"samples_ns\": [";
+
+				for (size_t j = 0; j < result.samples.size(); ++j) {
+					_out << (j ? ", " : "") << result.samples[j];
+				}
+
+				_out << "]}";
+			}
+
+			_out << "\n  ]\n}\n";
+		}
+
+		// One row per case, times in nanoseconds
+		void write_csv(std::ostream& _out) const
+		{
+			_out << std::setprecision(15) << "name,iterations,min_ns,median_ns,mean_ns,p90_ns,p99_ns,stddev_ns,max_ns,bytes,items,mb_per_s,items_per_s,ns_per_item\n";
+
+			for (const auto& result : m_results)
+			{
+				const auto& s = result.summary;
+
+				_out << '"' << result.name << "\"," << s.samples << ',' << s.min << ',' << s.median << ',' << s.mean << ','
+					<< s.p90 << ',' << s.p99 << ',' << s.stddev << ',' << s.max << ','
+					<< result.bytes << ',' << result.items << ',' << result.mb_per_second() << ',' << result.items_per_second() << ',' << result.ns_per_item() << "\n";
+			}
+		}
+
+		// Print the table, write the files requested on the command line and compare against the baseline,
+		// returns the exit code: 1 if a case got significantly slower than the threshold, 2 if the baseline can`t be read
+		int report() const
+		{
+			print(std::cout);
+
+			if (!m_options.json.empty()) {
+				std::ofstream file(m_options.json);
+				write_json(file);
+			}
+
+			if (!m_options.csv.empty()) {
+				std::ofstream file(m_options.csv);
+				write_csv(file);
+			}
+
+			if (!m_options.save_baseline.empty()) {
+				std::ofstream file(m_options.save_baseline);
+				write_json(file);
+			}
+
+			if (m_options.baseline.empty()) {
+				return 0;
+			}
+
+			std::vector<result> baseline;
+
+			if (!load_baseline(m_options.baseline, baseline)) {
+				std::cerr << "Can`t read baseline " << m_options.baseline << "\n";
+				return 2;
+			}
+
+			return compare(std::cout, baseline) ? 1 : 0;
+		}
+
+		// Diff table against a baseline, true if a case regressed
+		bool compare(std::ostream& _out, const std::vector<result>& _baseline) const
+		{
+			bool regression = false;
+
+			_out << "\n" << std::left << std::setw(40) << "baseline comparison" << std::right
+				<< std::setw(14) << "baseline"
+				<< std::setw(14) << "current"
+				<< std::setw(10) << "change"
+				<< std::setw(12) << "p-value" << "  verdict\n";
+
+			for (const auto& current : m_results)
+			{
+				const auto base = std::find_if(_baseline.begin(), _baseline.end(), [&current](const result& _result) { return _result.name == current.name; });
+
+				if (base == _baseline.end()) {
+					_out << std::left << std::setw(40) << current.name << std::right << std::setw(14) << "-" << std::setw(14) << format_time(current.summary.median) << "  new\n";
+					continue;
+				}
+
+				const double change = (current.summary.median / base->summary.median - 1) * 100;
+				const double slower = mann_whitney(base->samples, current.samples);
+				const double faster = mann_whitney(current.samples, base->samples);
+
+				const char* verdict = "same";
+
+				if (slower < m_options.alpha && change > m_options.threshold) {
+					verdict = "REGRESSION";
+					regression = true;
+				}
+				else if (slower < m_options.alpha) {
+					verdict = "slower";
+				}
+				else if (faster < m_options.alpha) {
+					verdict = "faster";
+				}
+
+				char buffer[32];
+				std::snprintf(buffer, sizeof(buffer), "%+.1f%%", change);
+
+				_out << std::left << std::setw(40) << current.name << std::right
+					<< std::setw(14) << format_time(base->summary.median)
+					<< std::setw(14) << format_time(current.summary.median)
+					<< std::setw(10) << buffer
+					<< std::setw(12) << std::setprecision(3) << std::min(slower, faster) << std::defaultfloat
+					<< "  " << verdict << "\n";
+			}
+
+			return regression;
+		}
+
+		// Read names and samples back from write_json()
+		static bool load_baseline(const std::string& _filename, std::vector<result>& _results)
+		{
+			std::ifstream file(_filename);
+
+			if (file.good() == false) {
+				return false;
+			}
+
+			const std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+			constexpr std::string_view name_key = "{\"name\": \"";
+			constexpr std::string_view samples_key = "\"samples_ns\": [";
+
+			for (size_t pos = json.find(name_key); pos != std::string::npos; pos = json.find(name_key, pos))
+			{
+				result current;
+
+				for (pos += name_key.size(); pos < json.size() && json[pos] != '"'; ++pos) {
+					if (json[pos] == '\\') {
+						++pos;
+					}
+					current.name.push_back(json[pos]);
+				}
+
+				pos = json.find(samples_key, pos);
+
+				if (pos == std::string::npos) {
+					return false;
+				}
+
+				const char* ptr = json.c_str() + pos + samples_key.size();
+
+				while (*ptr != ']' && *ptr != 0)
+				{
+					char* end = nullptr;
+					const double sample = std::strtod(ptr, &end);
+
+					if (end == ptr) {
+						return false;
+					}
+
+					current.samples.push_back(sample);
+					ptr = end + std::strspn(end, ", ");
+				}
+
+				pos = ptr - json.c_str();
+				current.summary = stats::compute(current.samples);
+				_results.push_back(std::move(current));
+			}
+
+			return !_results.empty();
+		}
+
+		// One sided Mann-Whitney U test, p-value for "samples of b are larger than samples of a".
+		// Normal approximation with tie correction, fine for the sample counts the harness takes.
+		static double mann_whitney(const std::vector<double>& _a, const std::vector<double>& _b)
+		{
+			const double n1 = static_cast<double>(_a.size());
+			const double n2 = static_cast<double>(_b.size());
+
+			if (_a.empty() || _b.empty()) {
+				return 1;
+			}
+
+			std::vector<std::pair<double, bool>> all;  // Value, from b
+			all.reserve(_a.size() + _b.size());
+
+			for (const double value : _a) {
+				all.emplace_back(value, false);
+			}
+			for (const double value : _b) {
+				all.emplace_back(value, true);
+			}
+
+			std::sort(all.begin(), all.end(), [](const auto& _x, const auto& _y) { return _x.first < _y.first; });
+
+			double rank_sum = 0, ties = 0;
+
+			for (size_t i = 0; i < all.size();)
+			{
+				size_t j = i;
+
+				while (j < all.size() && all[j].first == all[i].first) {
+					++j;
+				}
+
+				const double rank = (i + j + 1) / 2.0;  // Average of the ranks i + 1 ... j
+				const double count = static_cast<double>(j - i);
+
+				for (size_t k = i; k < j; ++k) {
+					if (all[k].second) {
+						rank_sum += rank;
+					}
+				}
+
+				ties += count * count * count - count;
+				i = j;
+			}
+
+			const double u = rank_sum - n2 * (n2 + 1) / 2;
+			const double mean = n1 * n2 / 2;
+			const double n = n1 + n2;
+			const double variance = n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1)));
+
+			if (variance <= 0) {
+				return 1;
+			}
+
+			const double z = (u - mean - 0.5) / std::sqrt(variance);
+
+			return 0.5 * std::erfc(z / std::sqrt(2.0));
+		}
+
+	private:
+		void open_counters()
+		{
+			if (!m_options.counters) {
+				return;
+			}
+
+			m_counters = std::make_unique<perf_counters>();
+
+			if (!m_counters->open()) {
+				std::cerr << "No hardware counters available, only timing is reported\n";
+				m_counters.reset();
+			}
+		}
+
+		template <class Fn, class Input>
+		static double measure(Fn& _fn, Input& _input)
+		{
+			const auto start = clock::now();
+
+			if constexpr (std::is_void_v<decltype(_fn(_input))>) {
+				_fn(_input);
+			}
+			else {
+				do_not_optimize(_fn(_input));
+			}
+
+			const auto end = clock::now();
+
+			return std::chrono::duration<double, std::nano>(end - start).count();
+		}
+
+		static std::string format_time(const double _ns)
+		{
+			constexpr const char* units[] = { "ns", "us", "ms", "s" };
+
+			double value = _ns;
+			size_t unit = 0;
+
+			while (value >= 1000 && unit < 3) {
+				value /= 1000;
+				++unit;
+			}
+
+			char buffer[32];
+			std::snprintf(buffer, sizeof(buffer), "%.3f %s", value, units[unit]);
+
+			return buffer;
+		}
+
+		static std::string escape(const std::string_view& _str)
+		{
+			std::string result;
+
+			for (const char chr : _str) {
+				if (chr == '"' || chr == '\\') {
+					result.push_back('\\');
+				}
+				result.push_back(chr);
+			}
+
+			return result;
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,141 @@
+#pragma once
+
+#ifndef _RSA_BENCH_PERF_COUNTERS_
+#define _RSA_BENCH_PERF_COUNTERS_
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifdef __linux__
+	#include <linux/perf_event.h>
+	#include <sys/ioctl.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#endif
+
+namespace bench
+{
+	// Hardware and software counters of this process and the threads it starts (Linux perf_event_open).
+	// Counters the kernel refuses, e.g. in containers or with perf_event_paranoid set, read as unavailable.
+	class perf_counters
+	{
+	private:
+		struct counter
+		{
+			const char* name;
+			uint32_t type;
+			uint64_t config;
+			int fd = -1;
+		};
+
+#ifdef __linux__
+		std::vector<counter> m_counters = {
+			{ "cycles",           PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+			{ "instructions",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+			{ "cache_misses",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+			{ "branch_misses",    PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+			{ "context_switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+			{ "page_faults",      PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS }
+		};
+#else
+		std::vector<counter> m_counters;
+#endif
+
+	public:
+		perf_counters() = default;
+
+		perf_counters(const perf_counters&) = delete;
+		perf_counters& operator=(const perf_counters&) = delete;
+
+		~perf_counters()
+		{
+			close();
+		}
+
+		// Open all counters, false if none is available
+		bool open()
+		{
+			bool any = false;
+
+#ifdef __linux__
+			for (auto& counter : m_counters)
+			{
+				perf_event_attr attr;
+				std::memset(&attr, 0, sizeof(attr));
+
+				attr.size = sizeof(attr);
+				attr.type = counter.type;
+				attr.config = counter.config;
+				attr.exclude_kernel = (counter.type == PERF_TYPE_HARDWARE);  // Software events happen in the kernel
+				attr.exclude_hv = 1;
+				attr.inherit = 1;  // Count the threads the library starts for every block
+				attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+				counter.fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+
+				if (counter.fd < 0) {
+					std::cerr << "Counter " << counter.name << " is not available: " << std::strerror(errno) << "\n";
+					continue;
+				}
+
+				any = true;
+			}
+#else
+			std::cerr << "Hardware counters are only available on Linux\n";
+#endif
+
+			return any;
+		}
+
+		void close() noexcept
+		{
+#ifdef __linux__
+			for (auto& counter : m_counters) {
+				if (counter.fd >= 0) {
+					::close(counter.fd);
+					counter.fd = -1;
+				}
+			}
+#endif
+		}
+
+		size_t size() const noexcept
+		{
+			return m_counters.size();
+		}
+
+		const char* name(const size_t _index) const noexcept
+		{
+			return m_counters[_index].name;
+		}
+
+		bool available(const size_t _index) const noexcept
+		{
+			return m_counters[_index].fd >= 0;
+		}
+
+		// Current values, scaled up if the kernel multiplexed a counter, 0 for unavailable ones
+		void read(std::vector<double>& _values) const
+		{
+			_values.assign(m_counters.size(), 0);
+
+#ifdef __linux__
+			for (size_t i = 0; i < m_counters.size(); ++i)
+			{
+				uint64_t data[3] = { };
+
+				if (m_counters[i].fd < 0 || ::read(m_counters[i].fd, data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) {
+					continue;
+				}
+
+				_values[i] = (data[2] != 0 && data[2] < data[1]) ? static_cast<double>(data[0]) * data[1] / data[2] : static_cast<double>(data[0]);
+			}
+#endif
+		}
+	};
+}
+
+#endif
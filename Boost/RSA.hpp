@@ -12,6 +12,41 @@
 #include <future>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <exception>
+#include <atomic>
+#include <memory>
+#include <iterator>
+#include <optional>
+#include <unordered_set>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+    #include <coroutine>
+#endif
 
 #ifndef _NODISCARD
     #define _NODISCARD [[nodiscard]]
@@ -24,6 +59,14 @@ namespace RSA
     template<class, bool>
     class basic_rsa;
 
+    template<class, bool>
+    class basic_public_key;
+
+    template<class, bool>
+    class basic_private_key;
+
+    class keystore;
+
     // char, no throw
     using RSA = basic_rsa<char, false>;
     // char, throw
@@ -51,717 +94,6848 @@ namespace RSA
     // char32_t, throw
     using u32tRSA = basic_rsa<char32_t, true>;
 
+    // Immutable keys for char, no throw
+    using PublicKey = basic_public_key<char, false>;
+    using PrivateKey = basic_private_key<char, false>;
+
     typedef boost::multiprecision::cpp_int number_t;
 
-    namespace detail
+    // Runs one task of an operation on some thread, e.g. by submitting it to the thread pool of the application
+    // (see basic_rsa::set_executor() and set_default_executor())
+    using executor = std::function<void(std::function<void()>)>;
+
+#ifdef RSA_ENABLE_METRICS
+    // Operations measured with RSA_ENABLE_METRICS
+    enum class metric : uint32_t
     {
-        // * Decimal to number
-        template <class Ty = int64_t>
-        _NODISCARD constexpr Ty dton(const char* str) {
-            constexpr Ty _max = std::numeric_limits<Ty>::max();
+        setup,      // Key generation
+        encrypt,    // Any encrypt call
+        decrypt,    // Any decrypt call
+        block,      // One modular exponentiation of a block
+        import,     // Key import
+        export_,    // Key export
+        count
+    };
 
-            bool _negative = false;
+    namespace detail
+    {
+        // Log-linear latency buckets in nanoseconds: 8 sub-buckets per power of two (12.5% precision) up to 2^40 ns
+        constexpr static inline size_t METRIC_SUB_BUCKETS = 8;
+        constexpr static inline size_t METRIC_BUCKETS = (40 - 2) * METRIC_SUB_BUCKETS;
 
-            if (*str == '-') {
-                _negative = true;
-                ++str;
+        _NODISCARD inline size_t metric_bucket(const uint64_t _ns) noexcept
+        {
+            if (_ns < METRIC_SUB_BUCKETS) {
+                return static_cast<size_t>(_ns);
             }
 
-            Ty result = 0;
-            while (*str)
-            {
-                if (*str < '0' || *str > '9')
-                    throw std::invalid_argument("only number strings");
+#ifdef _MSC_VER
+            unsigned long msb;
+            _BitScanReverse64(&msb, _ns);
+#else
+            const uint32_t msb = 63 - __builtin_clzll(_ns);
+#endif
 
-                const Ty temp = result * 10 + (*str++ - '0');
-                
-                if (temp < result)
-                    return _max;
+            const size_t bucket = (msb - 2) * METRIC_SUB_BUCKETS + ((_ns >> (msb - 3)) & (METRIC_SUB_BUCKETS - 1));
 
-                result = temp;
+            return std::min(bucket, METRIC_BUCKETS - 1);
+        }
+
+        // Smallest value of a bucket
+        _NODISCARD constexpr uint64_t metric_bucket_floor(const size_t _bucket) noexcept
+        {
+            if (_bucket < METRIC_SUB_BUCKETS) {
+                return _bucket;
             }
-            
-            if (_negative)
-                result *= -1;
 
-            return result;
+            return (METRIC_SUB_BUCKETS + _bucket % METRIC_SUB_BUCKETS) << (_bucket / METRIC_SUB_BUCKETS - 1);
         }
 
-        // * Hex to number
-        template <class Ty = int64_t>
-        _NODISCARD constexpr Ty hton(const char* str)
+        // Bumped by reset_metrics(), counters are baselined but the maximum of each thread is cleared with it
+        inline std::atomic<uint64_t> metric_epoch{ 0 };
+
+        // Counters of one thread, only written by that thread so recording needs no atomic read-modify-write
+        struct thread_metrics
         {
-            constexpr Ty _max = std::numeric_limits<Ty>::max();
+            struct op_t
+            {
+                std::atomic<uint64_t> count{ 0 };
+                std::atomic<uint64_t> total_ns{ 0 };
+                std::atomic<uint64_t> max_ns{ 0 };
+                std::array<std::atomic<uint64_t>, METRIC_BUCKETS> buckets{ };
+            };
 
-            bool _negative = false;
+            std::array<op_t, static_cast<size_t>(metric::count)> ops;
 
-            if (*str == '-') {
-                _negative = true;
-                ++str;
+            // The max_ns values belong to this metric_epoch, older ones are stale after a reset
+            std::atomic<uint64_t> epoch{ metric_epoch.load(std::memory_order_acquire) };
+
+            // Check if max_ns is from the current metric_epoch
+            _NODISCARD bool current() const noexcept
+            {
+                return epoch.load(std::memory_order_acquire) == metric_epoch.load(std::memory_order_acquire);
             }
 
-            Ty result = 0;
-            while (*str)
+            void record(const metric _metric, const uint64_t _ns) noexcept
             {
-                Ty temp = result * 16;
+                const uint64_t last = metric_epoch.load(std::memory_order_acquire);
 
-                if (*str >= '0' && *str <= '9') {
-                    temp += *str++ - '0';
-                }
-                else if (*str >= 'a' && *str <= 'f') {
-                    temp += 10 + *str++ - 'a';
-                }
-                else if (*str >= 'A' && *str <= 'F') {
-                    temp += 10 + *str++ - 'A';
+                if (epoch.load(std::memory_order_relaxed) != last)
+                {
+                    for (auto& each : ops) {
+                        each.max_ns.store(0, std::memory_order_relaxed);
+                    }
+
+                    epoch.store(last, std::memory_order_release);
                 }
-                else {
-                    throw std::invalid_argument("only hex number strings");
+
+                op_t& op = ops[static_cast<size_t>(_metric)];
+                auto& bucket = op.buckets[metric_bucket(_ns)];
+
+                op.count.store(op.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                op.total_ns.store(op.total_ns.load(std::memory_order_relaxed) + _ns, std::memory_order_relaxed);
+                bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+                if (_ns > op.max_ns.load(std::memory_order_relaxed)) {
+                    op.max_ns.store(_ns, std::memory_order_relaxed);
                 }
+            }
+        };
 
-                if (temp < result) {
-                    return _max;
+        // Merged counters of all threads
+        struct metric_totals
+        {
+            struct op_t
+            {
+                uint64_t count = 0;
+                uint64_t total_ns = 0;
+                uint64_t max_ns = 0;
+                std::array<uint64_t, METRIC_BUCKETS> buckets{ };
+            };
+
+            std::array<op_t, static_cast<size_t>(metric::count)> ops{ };
+
+            void add(const thread_metrics& _thread) noexcept
+            {
+                const bool current = _thread.current();
+
+                for (size_t i = 0; i < ops.size(); ++i)
+                {
+                    ops[i].count += _thread.ops[i].count.load(std::memory_order_relaxed);
+                    ops[i].total_ns += _thread.ops[i].total_ns.load(std::memory_order_relaxed);
+
+                    if (current) {
+                        ops[i].max_ns = std::max(ops[i].max_ns, _thread.ops[i].max_ns.load(std::memory_order_relaxed));
+                    }
+
+                    for (size_t j = 0; j < METRIC_BUCKETS; ++j) {
+                        ops[i].buckets[j] += _thread.ops[i].buckets[j].load(std::memory_order_relaxed);
+                    }
                 }
+            }
+        };
 
-                result = temp;
+        // All live threads, counters of finished threads are folded into m_retired
+        class metric_registry
+        {
+        private:
+            std::mutex m_mutex;
+            std::vector<std::shared_ptr<thread_metrics>> m_threads;
+            std::unique_ptr<metric_totals> m_retired = std::make_unique<metric_totals>();
+            std::unique_ptr<metric_totals> m_baseline = std::make_unique<metric_totals>();
+
+        public:
+            _NODISCARD static metric_registry& get()
+            {
+                static metric_registry registry;
+                return registry;
             }
 
-            if (_negative)
-                result *= -1;
+            _NODISCARD std::shared_ptr<thread_metrics> add()
+            {
+                auto metrics = std::make_shared<thread_metrics>();
 
-            return result;
-        }
-    }
-    
-    template<class _char, bool _throw>
-    void print(basic_rsa<_char, _throw> _rsa) {
-        std::cout << _rsa;
-    }
+                std::lock_guard<std::mutex> guard(m_mutex);
+                m_threads.push_back(metrics);
 
-    template <class char_type = char, bool throw_errors = false> 
-    class basic_rsa
-    {
-    private:
-        
-        constexpr static inline auto one_in_block_size = std::numeric_limits<char_type>::digits10 + 2;
-        constexpr static inline auto char_size = sizeof(char_type);
-        const static inline auto thread_count = (std::thread::hardware_concurrency() == 0) ? 1 : std::thread::hardware_concurrency();
+                return metrics;
+            }
 
-        typedef std::tuple<number_t, number_t, number_t, number_t, uint32_t, uint32_t> export_t;
-        using string = std::basic_string<char_type>;
-        using string_view = std::basic_string_view<char_type>;
+            void retire(const std::shared_ptr<thread_metrics>& _metrics)
+            {
+                std::lock_guard<std::mutex> guard(m_mutex);
 
-    protected:
-        constexpr static inline uint32_t DEFAULT_BITS = static_cast<uint32_t>(3072);
-        constexpr static inline uint32_t DEFAULT_TRYS = static_cast<uint32_t>(-1);
-        constexpr static inline uint32_t MIN_BLOCKSIZE = static_cast<uint32_t>(one_in_block_size);
+                m_retired->add(*_metrics);
+                m_threads.erase(std::remove(m_threads.begin(), m_threads.end(), _metrics), m_threads.end());
+            }
 
-    private:
-        bool m_setupdone = false;
-        uint32_t m_bits = DEFAULT_BITS;
-        uint32_t m_trys = DEFAULT_TRYS;
+            // Counters since the last reset
+            _NODISCARD std::unique_ptr<metric_totals> merge()
+            {
+                auto totals = std::make_unique<metric_totals>();
 
-    public:
-        uint32_t e = 0;
-        number_t p, q, n, d;
+                std::lock_guard<std::mutex> guard(m_mutex);
 
-        std::tuple<uint32_t&, number_t&> public_key { e, n };
-        std::tuple<number_t&, number_t&> private_key{ d, n };
+                *totals = *m_retired;
 
-    public:
-        constexpr basic_rsa() :m_bits(3072), m_trys(17) {
+                for (const auto& thread : m_threads) {
+                    totals->add(*thread);
+                }
 
-        }
+                for (size_t i = 0; i < totals->ops.size(); ++i)
+                {
+                    totals->ops[i].count -= m_baseline->ops[i].count;
+                    totals->ops[i].total_ns -= m_baseline->ops[i].total_ns;
 
-        constexpr basic_rsa(const uint32_t _bits, const uint32_t _trys = DEFAULT_TRYS) {
-            set(_bits, _trys);
-        }
+                    for (size_t j = 0; j < METRIC_BUCKETS; ++j) {
+                        totals->ops[i].buckets[j] -= m_baseline->ops[i].buckets[j];
+                    }
+                }
 
-        // Import values from exported RSA file
-        constexpr basic_rsa(const std::string_view& _file) {
-            import_file(_file);
-        }
+                return totals;
+            }
 
-        // Import values from exported RSA file
-        constexpr basic_rsa(std::ifstream& _file) {
-            import_file(_file);
-        }
+            // Counters are only written by their threads, so a reset keeps the current values as baseline and starts
+            // a new metric_epoch, each thread clears its maximum when it records the next time
+            void reset()
+            {
+                auto totals = std::make_unique<metric_totals>();
 
-        // Import values from other RSA class
-        constexpr basic_rsa(const export_t& _key) {
-            import_key(_key);
-        }
+                std::lock_guard<std::mutex> guard(m_mutex);
 
-        // Check if setup() is already done
-        _NODISCARD constexpr operator bool() const noexcept
-        {
-            return m_setupdone;
-        }
+                metric_epoch.fetch_add(1, std::memory_order_acq_rel);
 
-        // Check if setup() is already done
-        _NODISCARD constexpr bool setupdone() const noexcept
-        {
-            return m_setupdone;
-        }
+                *totals = *m_retired;
 
-        // The bits of the generated primes
-        _NODISCARD constexpr uint32_t keysize() const noexcept
-        {
-            return m_bits;
-        }
+                for (const auto& thread : m_threads) {
+                    totals->add(*thread);
+                }
 
-        // The current amouth of Miller Rabin tests
-        _NODISCARD constexpr uint32_t trys() const noexcept
-        {
-            return m_trys;
-        }
+                for (auto& op : m_retired->ops) {
+                    op.max_ns = 0;
+                }
 
-        // How likely the numbers generated are prime in percent
-        _NODISCARD constexpr double_t precision() const noexcept
+                m_baseline = std::move(totals);
+            }
+        };
+
+        _NODISCARD inline thread_metrics& local_metrics()
         {
-            return 100.0 - (std::pow(2, static_cast<int64_t>(m_trys) * -1) * 100.0);
+            struct slot_t
+            {
+                std::shared_ptr<thread_metrics> metrics = metric_registry::get().add();
+
+                ~slot_t()
+                {
+                    metric_registry::get().retire(metrics);
+                }
+            };
+
+            thread_local slot_t slot;
+
+            return *slot.metrics;
         }
-        
-        // Set new keysize, blocksize and trys
-        constexpr void set(uint32_t _bits = DEFAULT_BITS, uint32_t _trys = DEFAULT_TRYS) noexcept(!throw_errors)
+
+        // Records the time from construction to destruction
+        class metric_scope
         {
-            if (_bits == 0) {
-                if constexpr (throw_errors) {
-                    throw std::invalid_argument("key size can`t be 0");
-                }
+        private:
+            const metric m_metric;
+            const std::chrono::steady_clock::time_point m_start = std::chrono::steady_clock::now();
+
+        public:
+            explicit metric_scope(const metric _metric) noexcept : m_metric(_metric)
+            {
 
-                _bits = DEFAULT_BITS;
             }
 
-            if (_trys == 0) {
-                if constexpr (throw_errors) {
-                    throw std::invalid_argument("can`t have 0 trys");
-                }
+            metric_scope(const metric_scope&) = delete;
+            metric_scope& operator=(const metric_scope&) = delete;
 
-                _trys = DEFAULT_TRYS;
+            ~metric_scope()
+            {
+                const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+                local_metrics().record(m_metric, static_cast<uint64_t>(ns));
             }
+        };
+    }
 
-            if (_bits % 8 != 0) {
-                if constexpr (throw_errors) {
-                    throw std::invalid_argument("keysize has to be dividable by 8");
-                }
+    // Merged counters and latency percentiles of all threads
+    struct metrics_snapshot
+    {
+        struct op_t
+        {
+            const char* name = "";
+            uint64_t count = 0;
+            double total_seconds = 0;
+            double p50_seconds = 0, p90_seconds = 0, p99_seconds = 0, max_seconds = 0;
+        };
 
-                _bits = (8 - _bits % 8);
-            }
+        std::vector<op_t> ops;
 
-            m_bits = _bits;
+        // Prometheus text exposition format
+        _NODISCARD std::string prometheus() const
+        {
+            std::string out;
 
-            if (_trys == DEFAULT_TRYS) {
-                m_trys = get_rabin_trys(_bits);
+            out += "# HELP rsa_operations_total Completed library operations\n";
+            out += "# TYPE rsa_operations_total counter\n";
+
+            for (const auto& op : ops) {
+                out += "rsa_operations_total{op=\"" + std::string(op.name) + "\"} " + std::to_string(op.count) + "\n";
             }
-            else {
-                m_trys = _trys;
+
+            out += "# HELP rsa_operation_duration_seconds Latency of library operations\n";
+            out += "# TYPE rsa_operation_duration_seconds summary\n";
+
+            for (const auto& op : ops)
+            {
+                const std::string label = "rsa_operation_duration_seconds{op=\"" + std::string(op.name) + "\"";
+
+                out += label + ",quantile=\"0.5\"} " + format(op.p50_seconds) + "\n";
+                out += label + ",quantile=\"0.9\"} " + format(op.p90_seconds) + "\n";
+                out += label + ",quantile=\"0.99\"} " + format(op.p99_seconds) + "\n";
+                out += label + ",quantile=\"1\"} " + format(op.max_seconds) + "\n";
+                out += "rsa_operation_duration_seconds_sum{op=\"" + std::string(op.name) + "\"} " + format(op.total_seconds) + "\n";
+                out += "rsa_operation_duration_seconds_count{op=\"" + std::string(op.name) + "\"} " + std::to_string(op.count) + "\n";
             }
-        }
 
-        // Set the size of the key
-        constexpr void set_keysize(const uint32_t _bits)
-        {
-            set(_bits, m_trys);
+            return out;
         }
 
-        // Set how many Miller Rabin tests to perform
-        constexpr void set_trys(const uint32_t _trys)
+        _NODISCARD std::string json() const
         {
-            set(m_bits, _trys);
+            std::string out = "{";
+
+            for (size_t i = 0; i < ops.size(); ++i)
+            {
+                const auto& op = ops[i];
+
+                out += (i ? ", \"" : "\"") + std::string(op.name) + "\": {\"count\": " + std::to_string(op.count)
+                    + ", \"total_seconds\": " + format(op.total_seconds)
+                    + ", \"p50_seconds\": " + format(op.p50_seconds)
+                    + ", \"p90_seconds\": " + format(op.p90_seconds)
+                    + ", \"p99_seconds\": " + format(op.p99_seconds)
+                    + ", \"max_seconds\": " + format(op.max_seconds) + "}";
+            }
+
+            return out + "}";
         }
 
-        // Import file from a filepath
-        bool import_file(const std::string_view& _filename)
+    private:
+        _NODISCARD static std::string format(const double _value)
         {
-            std::ifstream _file(_filename.data());
-            return import_file(_file);
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.9g", _value);
+            return buffer;
         }
+    };
 
-        // Import file from an ifstream
-        bool import_file(std::ifstream& _file)
-        {
-            if (_file.good() == false) {
-                return false;
-            }
+    // Snapshot of the metrics since the start or the last reset_metrics()
+    _NODISCARD inline metrics_snapshot snapshot_metrics()
+    {
+        constexpr const char* names[] = { "setup", "encrypt", "decrypt", "block", "import", "export" };
 
-            std::string _line;
+        const auto totals = detail::metric_registry::get().merge();
 
-            do
-            {
-                if (!std::getline(_file, _line)) {
-                    _file.close();
-                    return false;
-                }
-            } while (_line != "-----BEGIN EXPORT-----");
+        metrics_snapshot snapshot;
 
-            if (std::getline(_file, _line))
-                p.assign(_line);
+        for (size_t i = 0; i < totals->ops.size(); ++i)
+        {
+            const auto& op = totals->ops[i];
 
-            if (std::getline(_file, _line))
-                q.assign(_line);
+            metrics_snapshot::op_t result;
+            result.name = names[i];
+            result.count = op.count;
+            result.total_seconds = op.total_ns * 1e-9;
 
-            if (std::getline(_file, _line))
-                n.assign(_line);
+            if (op.count == 0) {
+                snapshot.ops.push_back(result);
+                continue;
+            }
 
-            if (std::getline(_file, _line))
-                d.assign(_line);
+            // Upper end of the bucket that holds the percentile, the maximum since the reset caps it
+            auto percentile = [&op](const double _p) -> double
+            {
+                const uint64_t rank = static_cast<uint64_t>(std::ceil(_p * op.count));
+                uint64_t seen = 0;
 
-            if (std::getline(_file, _line))
-                e = detail::dton<uint32_t>(_line.c_str());
+                for (size_t j = 0; j < detail::METRIC_BUCKETS; ++j)
+                {
+                    seen += op.buckets[j];
 
-            if (std::getline(_file, _line))
-                m_bits = detail::dton<uint32_t>(_line.c_str());
+                    if (seen >= rank && seen != 0) {
+                        return std::min(detail::metric_bucket_floor(j + 1), op.max_ns) * 1e-9;
+                    }
+                }
 
-            _file.close();
-            
-            set(m_bits);
+                return op.max_ns * 1e-9;
+            };
 
-            m_setupdone = true;
+            result.p50_seconds = percentile(0.5);
+            result.p90_seconds = percentile(0.9);
+            result.p99_seconds = percentile(0.99);
+            result.max_seconds = percentile(1.0);
 
-            return true;
+            snapshot.ops.push_back(result);
         }
 
-        // Import setup from other RSA class export
-        void import_key(const export_t& _key)
-        {
-            p = std::get<0>(_key);
-            q = std::get<1>(_key);
-            n = std::get<2>(_key);
-            d = std::get<3>(_key);
-            e = std::get<4>(_key);
-            m_bits = std::get<5>(_key);
+        return snapshot;
+    }
 
-            set(m_bits);
+    inline void reset_metrics()
+    {
+        detail::metric_registry::get().reset();
+    }
 
-            m_setupdone = true;
-        }
+    #define RSA_METRIC_SCOPE(_metric) const ::RSA::detail::metric_scope _rsa_metric_scope(::RSA::metric::_metric)
+#else
+    // Compiled out without RSA_ENABLE_METRICS
+    #define RSA_METRIC_SCOPE(_metric)
+#endif
 
-        // Export current setup to a filepath
-        bool export_file(const std::string_view& _filename)
+#ifdef RSA_ENABLE_TRACING
+    namespace detail
+    {
+        // Events kept per thread, the oldest ones are overwritten
+        constexpr static inline size_t TRACE_CAPACITY = 1 << 16;
+
+        struct trace_event
         {
-            std::ofstream _file(_filename.data());
-            return export_file(_file);
-        }
+            const char* name;  // String literal
+            uint64_t ts_ns;
+            char phase;        // 'B' begin, 'E' end
+        };
 
-        // Export current setup to an ostream
-        bool export_file(std::ofstream& _file)
+        // Ring buffer of one thread, allocated up front so recording never allocates. The mutex is only contended
+        // while the trace is written
+        struct thread_trace
         {
-            if (m_setupdone == false) {
-                throw std::exception("You have to call setup() before you try to export a key.");
-            }
+            std::mutex lock;
+            uint32_t tid = 0;
+            std::vector<trace_event> events = std::vector<trace_event>(TRACE_CAPACITY);
+            size_t head = 0;
+            size_t count = 0;
 
-            if (_file.good() == false) {
-                return false;
+            void record(const char* _name, const char _phase, const uint64_t _ts) noexcept
+            {
+                std::lock_guard<std::mutex> guard(lock);
+
+                events[head] = { _name, _ts, _phase };
+                head = (head + 1) % TRACE_CAPACITY;
+                count = std::min(count + 1, TRACE_CAPACITY);
             }
+        };
 
-            _file << "-----BEGIN EXPORT-----\n";
+        // Buffers of all threads, finished threads are kept until the trace is written
+        class trace_registry
+        {
+        private:
+            std::mutex m_mutex;
+            std::vector<std::shared_ptr<thread_trace>> m_threads;
+            uint32_t m_next_tid = 1;
 
-            _file << p.str() << '\n';
-            _file << q.str() << '\n';
-            _file << n.str() << '\n';
-            _file << d.str() << '\n';
-            _file << std::to_string(e) << '\n';
-            _file << std::to_string(m_bits) << '\n';
+        public:
+            const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
 
-            _file << "-----END EXPORT-----\n";
+            _NODISCARD static trace_registry& get()
+            {
+                static trace_registry registry;
+                return registry;
+            }
 
-            _file.close();
+            _NODISCARD std::shared_ptr<thread_trace> add()
+            {
+                auto trace = std::make_shared<thread_trace>();
 
-            return true;
-        }
+                std::lock_guard<std::mutex> guard(m_mutex);
 
-        // Export current setup
-        _NODISCARD const export_t export_key()
-        {
-            return { p, q, n, d, e, m_bits };
-        }
+                trace->tid = m_next_tid++;
+                m_threads.push_back(trace);
 
-        // Generate the primes
-        void setup() noexcept
-        {
-            m_setupdone = false;
+                return trace;
+            }
 
-            while (true)
+            // Write all events as Chrome Trace Event JSON and clear them, buffers of finished threads are dropped. End
+            // events whose begin was overwritten or written by the last call are left out
+            void write(std::ostream& _out)
             {
-                const auto pair = generate_prime_pair(m_bits, m_trys);
+                std::lock_guard<std::mutex> guard(m_mutex);
 
-                p = pair.first;
-                q = pair.second;
+                _out << "{\"traceEvents\": [";
 
-                n = p * q;
+                bool first = true;
+                char buffer[64];
 
-                const number_t phi = (p - 1) * (q - 1);
+                for (const auto& thread : m_threads)
+                {
+                    std::lock_guard<std::mutex> thread_guard(thread->lock);
 
-                e = 65537;
+                    _out << (first ? "\n" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << thread->tid
+                        << ", \"args\": {\"name\": \"rsa-" << thread->tid << "\"}}";
+                    first = false;
 
-                if (boost::multiprecision::gcd(e, phi) != 1) {
-                    e = 2;
-                    while (boost::multiprecision::gcd(e, phi) != 1) {
-                        ++e;
+                    size_t depth = 0;
+
+                    for (size_t i = 0; i < thread->count; ++i)
+                    {
+                        const trace_event& event = thread->events[(thread->head + TRACE_CAPACITY - thread->count + i) % TRACE_CAPACITY];
+
+                        if (event.phase == 'B') {
+                            ++depth;
+                        }
+                        else if (depth == 0) {
+                            continue;
+                        }
+                        else {
+                            --depth;
+                        }
+
+                        std::snprintf(buffer, sizeof(buffer), "%.3f", event.ts_ns / 1000.0);
+
+                        _out << ",\n{\"name\": \"" << event.name << "\", \"ph\": \"" << event.phase << "\", \"ts\": " << buffer
+                            << ", \"pid\": 1, \"tid\": " << thread->tid << "}";
                     }
-                }
-                
-                d = inverse_mod(e, phi);
 
-                if ((e * d) % phi == 1) {
-                    break;
+                    thread->count = 0;
                 }
+
+                _out << "\n], \"displayTimeUnit\": \"ns\"}\n";
+
+                m_threads.erase(std::remove_if(m_threads.begin(), m_threads.end(), [](const auto& _thread) { return _thread.use_count() == 1; }), m_threads.end());
             }
+        };
 
-            m_setupdone = true;
+        _NODISCARD inline thread_trace& local_trace()
+        {
+            thread_local const std::shared_ptr<thread_trace> trace = trace_registry::get().add();
+            return *trace;
         }
 
-        // Encrypts a string
-        _NODISCARD std::vector<number_t> encrypt(const string_view& _str, const std::tuple<uint32_t&, number_t&>& _public_key)
+        // Begin event on construction, end event on destruction
+        class trace_scope
         {
-            check_setup();
-
-            const uint32_t& e = std::get<0>(_public_key);
-            const number_t& n = std::get<1>(_public_key);
-
-            auto pow_block = [e, n](const number_t& _block) noexcept -> number_t {
-                return boost::multiprecision::powm(_block, e, n);
-            };
+        private:
+            const char* m_name;
 
-            if (_str.empty()) {
-                if constexpr (throw_errors) {
-                    throw std::invalid_argument("Can`t Encrypt empty string");
-                }
-                return { };
+            _NODISCARD static uint64_t now() noexcept
+            {
+                return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - trace_registry::get().epoch).count());
             }
 
-            const auto blocks = create_blocks(_str, n, m_bits);
-
-            std::vector<std::future<number_t>> threads;
-
-            for (uint64_t i = 0; i < blocks.size(); ++i) {
-                threads.push_back(std::async(std::launch::async, pow_block, blocks.at(i)));
+        public:
+            explicit trace_scope(const char* _name) noexcept : m_name(_name)
+            {
+                local_trace().record(m_name, 'B', now());
             }
 
-            std::vector<number_t> result;
+            trace_scope(const trace_scope&) = delete;
+            trace_scope& operator=(const trace_scope&) = delete;
 
-            for (auto& thread : threads) {
-                result.push_back(thread.get());
+            ~trace_scope()
+            {
+                local_trace().record(m_name, 'E', now());
             }
+        };
+    }
 
-            return result;
-        }
+    // Write the recorded events as Chrome Trace Event JSON (chrome://tracing, ui.perfetto.dev) and clear them
+    inline void write_trace(std::ostream& _out)
+    {
+        detail::trace_registry::get().write(_out);
+    }
 
-        // Decrypts the encrypted blocks
-        _NODISCARD string decrypt(const std::vector<number_t>& _encrypted) const
-        {
-            check_setup();
+    inline bool write_trace(const std::string_view& _filename)
+    {
+        std::ofstream _file{ std::string(_filename) };
 
-            auto decrypt_block = [this](const number_t& _block) noexcept -> string
-            {
-                const std::string decrypted = boost::multiprecision::powm(_block, d, n).convert_to<std::string>();
+        if (_file.good() == false) {
+            return false;
+        }
 
-                string result; result.reserve(decrypted.size());
+        write_trace(_file);
 
-                for (uint32_t i = 0; decrypted.at(i) != '0' || i > decrypted.size();)
-                {
-                    uint8_t _len = decrypted.at(i++) - '0';
+        return _file.good();
+    }
 
-                    if (decrypted.at(i) == '0' && _len > 1) {
-                        const auto _chr = decrypted.substr(++i, --_len);
-                        const auto _dec = detail::dton<char_type>(_chr.data()) * (-1);
-                        result.push_back(_dec);
-                    }
-                    else {
-                        const auto _chr = decrypted.substr(i, _len);
-                        const auto _dec = detail::dton<char_type>(_chr.data());
-                        result.push_back(_dec);
-                    }
+    #define RSA_TRACE_SCOPE(_name) const ::RSA::detail::trace_scope _rsa_trace_scope(_name)
+#else
+    // Compiled out without RSA_ENABLE_TRACING
+    #define RSA_TRACE_SCOPE(_name)
+#endif
 
-                    i += _len;
-                }
+    namespace detail
+    {
+        // * Decimal to number
+        template <class Ty = int64_t>
+        _NODISCARD constexpr Ty dton(const char* str) {
+            constexpr Ty _max = std::numeric_limits<Ty>::max();
 
-                return result;
-            };
-            
-            std::vector<std::future<string>> threads;
+            bool _negative = false;
 
-            for (uint64_t i = 0; i < _encrypted.size(); ++i) {
-                threads.push_back(std::async(std::launch::async, decrypt_block, _encrypted.at(i)));
+            if (*str == '-') {
+                _negative = true;
+                ++str;
             }
 
-            string decrypted; decrypted.reserve(_encrypted.size() * char_size);
+            Ty result = 0;
+            while (*str)
+            {
+                if (*str < '0' || *str > '9')
+                    throw std::invalid_argument("only number strings");
+
+                const Ty temp = result * 10 + (*str++ - '0');
+                
+                if (temp < result)
+                    return _max;
 
-            for (auto& thread : threads) {
-                decrypted.append(thread.get());
+                result = temp;
             }
+            
+            if (_negative)
+                result *= -1;
 
-            return decrypted;
+            return result;
         }
 
-    private:
-        // Check if setup() has been called
-        void __forceinline check_setup() const
+        // * Hex to number
+        template <class Ty = int64_t>
+        _NODISCARD constexpr Ty hton(const char* str)
         {
-            if (m_setupdone == false) {
-                throw std::exception("You have to call setup() before you use the class");
-            }
-        } 
+            constexpr Ty _max = std::numeric_limits<Ty>::max();
 
-        // Creates the blocks for encryption
-        _NODISCARD static std::vector<number_t> create_blocks(const string_view& _str, const number_t& _n, const uint32_t _keysize) noexcept
-        {
-            uint32_t blocksize = std::max(_keysize, MIN_BLOCKSIZE);
+            bool _negative = false;
 
-            std::vector<number_t> blocks;
-            std::string msg; msg.reserve(blocksize * char_size);
-            uint32_t i = 0;
+            if (*str == '-') {
+                _negative = true;
+                ++str;
+            }
 
-            auto check_for_n = [_n, &blocksize](const number_t& _check) noexcept -> bool
+            Ty result = 0;
+            while (*str)
             {
-                if (_n < _check) {
-                    blocksize -= one_in_block_size;
-                    return false;
+                Ty temp = result * 16;
+
+                if (*str >= '0' && *str <= '9') {
+                    temp += *str++ - '0';
+                }
+                else if (*str >= 'a' && *str <= 'f') {
+                    temp += 10 + *str++ - 'a';
+                }
+                else if (*str >= 'A' && *str <= 'F') {
+                    temp += 10 + *str++ - 'A';
                 }
                 else {
-                    return true;
+                    throw std::invalid_argument("only hex number strings");
                 }
-            };
 
-            auto push_block = [&msg, &blocks, &i, check_for_n]() noexcept -> bool
-            {
-                number_t block(msg);
+                if (temp < result) {
+                    return _max;
+                }
 
-                const bool valid = check_for_n(block);
+                result = temp;
+            }
 
-                if (valid) {
-                    blocks.push_back(block);
-                }
-                else {
-                    i = 0;
-                    blocks.clear();
-                }
+            if (_negative)
+                result *= -1;
 
-                msg.clear();
+            return result;
+        }
 
-                return valid;
+        // SHA-256 (FIPS 180-4)
+        class sha256
+        {
+        public:
+            using digest_t = std::array<uint8_t, 32>;
+
+            constexpr static inline uint32_t K[64] = {
+                0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+                0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+                0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+                0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+                0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+                0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+                0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+                0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
             };
 
-            while (true)
+            constexpr static inline uint32_t H0[8] = {
+                0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+            };
+
+        private:
+            uint32_t m_state[8] = { H0[0], H0[1], H0[2], H0[3], H0[4], H0[5], H0[6], H0[7] };
+            uint8_t m_buffer[64] = { };
+            uint64_t m_length = 0;
+            size_t m_fill = 0;
+
+        public:
+            // Add data to the hash
+            sha256& update(const void* _data, size_t _size) noexcept
             {
-                const std::string    num = std::to_string(_str.at(i));
-                const bool      negative = (num.front() == '-');
-                const uint32_t  nextsize = msg.size() + num.size() + static_cast<int32_t>(negative) + 1;
+                const uint8_t* ptr = static_cast<const uint8_t*>(_data);
 
-                if (nextsize > blocksize) {
-                    msg.push_back('0');
-                    if (!push_block())
+                m_length += _size;
+
+                if (m_fill != 0) {
+                    const size_t take = std::min(64 - m_fill, _size);
+
+                    std::memcpy(m_buffer + m_fill, ptr, take);
+                    m_fill += take;
+                    ptr += take;
+                    _size -= take;
+
+                    if (m_fill != 64) {
+                        return *this;
+                    }
+
+                    compress(m_state, m_buffer);
+                    m_fill = 0;
+                }
+
+                for (; _size >= 64; ptr += 64, _size -= 64) {
+                    compress(m_state, ptr);
+                }
+
+                if (_size != 0) {
+                    std::memcpy(m_buffer, ptr, _size);
+                    m_fill = _size;
+                }
+
+                return *this;
+            }
+
+            // Finish the hash and return the digest
+            _NODISCARD digest_t final() noexcept
+            {
+                const uint64_t bits = m_length * 8;
+
+                m_buffer[m_fill++] = 0x80;
+
+                if (m_fill > 56) {
+                    std::memset(m_buffer + m_fill, 0, 64 - m_fill);
+                    compress(m_state, m_buffer);
+                    m_fill = 0;
+                }
+
+                std::memset(m_buffer + m_fill, 0, 56 - m_fill);
+
+                for (uint32_t i = 0; i < 8; ++i) {
+                    m_buffer[63 - i] = static_cast<uint8_t>(bits >> (i * 8));
+                }
+
+                compress(m_state, m_buffer);
+
+                digest_t digest;
+
+                for (uint32_t i = 0; i < 8; ++i) {
+                    store_be32(digest.data() + i * 4, m_state[i]);
+                }
+
+                return digest;
+            }
+
+            // Hash a buffer in one call
+            _NODISCARD static digest_t hash(const void* _data, const size_t _size) noexcept
+            {
+                return sha256().update(_data, _size).final();
+            }
+
+            _NODISCARD static constexpr uint32_t rotr(const uint32_t _x, const uint32_t _n) noexcept
+            {
+                return (_x >> _n) | (_x << (32 - _n));
+            }
+
+            _NODISCARD static uint32_t load_be32(const uint8_t* _ptr) noexcept
+            {
+                return (static_cast<uint32_t>(_ptr[0]) << 24) | (static_cast<uint32_t>(_ptr[1]) << 16) | (static_cast<uint32_t>(_ptr[2]) << 8) | _ptr[3];
+            }
+
+            static void store_be32(uint8_t* _ptr, const uint32_t _x) noexcept
+            {
+                _ptr[0] = static_cast<uint8_t>(_x >> 24);
+                _ptr[1] = static_cast<uint8_t>(_x >> 16);
+                _ptr[2] = static_cast<uint8_t>(_x >> 8);
+                _ptr[3] = static_cast<uint8_t>(_x);
+            }
+
+            // Process one 64 byte block
+            static void compress(uint32_t* _state, const uint8_t* _block) noexcept
+            {
+                uint32_t w[64];
+
+                for (uint32_t i = 0; i < 16; ++i) {
+                    w[i] = load_be32(_block + i * 4);
+                }
+
+                for (uint32_t i = 16; i < 64; ++i) {
+                    const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                    const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+                }
+
+                uint32_t a = _state[0], b = _state[1], c = _state[2], d = _state[3];
+                uint32_t e = _state[4], f = _state[5], g = _state[6], h = _state[7];
+
+                for (uint32_t i = 0; i < 64; ++i)
+                {
+                    const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+                    const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+
+                    h = g; g = f; f = e; e = d + t1;
+                    d = c; c = b; b = a; a = t1 + t2;
+                }
+
+                _state[0] += a; _state[1] += b; _state[2] += c; _state[3] += d;
+                _state[4] += e; _state[5] += f; _state[6] += g; _state[7] += h;
+            }
+        };
+
+        // SHA-256 of many messages with the same length, 8 messages are interleaved lane by lane so the rounds vectorize
+        class sha256_multi
+        {
+        public:
+            constexpr static inline size_t LANES = 8;
+
+        private:
+            using lanes_t = uint32_t[LANES];
+
+            static void compress(lanes_t (&_state)[8], const uint8_t* const (&_blocks)[LANES]) noexcept
+            {
+                using sha = sha256;
+
+                lanes_t w[64];
+
+                for (uint32_t i = 0; i < 16; ++i) {
+                    for (size_t l = 0; l < LANES; ++l) {
+                        w[i][l] = sha::load_be32(_blocks[l] + i * 4);
+                    }
+                }
+
+                for (uint32_t i = 16; i < 64; ++i) {
+                    for (size_t l = 0; l < LANES; ++l) {
+                        const uint32_t s0 = sha::rotr(w[i - 15][l], 7) ^ sha::rotr(w[i - 15][l], 18) ^ (w[i - 15][l] >> 3);
+                        const uint32_t s1 = sha::rotr(w[i - 2][l], 17) ^ sha::rotr(w[i - 2][l], 19) ^ (w[i - 2][l] >> 10);
+                        w[i][l] = w[i - 16][l] + s0 + w[i - 7][l] + s1;
+                    }
+                }
+
+                lanes_t a, b, c, d, e, f, g, h;
+
+                for (size_t l = 0; l < LANES; ++l) {
+                    a[l] = _state[0][l]; b[l] = _state[1][l]; c[l] = _state[2][l]; d[l] = _state[3][l];
+                    e[l] = _state[4][l]; f[l] = _state[5][l]; g[l] = _state[6][l]; h[l] = _state[7][l];
+                }
+
+                for (uint32_t i = 0; i < 64; ++i) {
+                    for (size_t l = 0; l < LANES; ++l)
+                    {
+                        const uint32_t t1 = h[l] + (sha::rotr(e[l], 6) ^ sha::rotr(e[l], 11) ^ sha::rotr(e[l], 25)) + ((e[l] & f[l]) ^ (~e[l] & g[l])) + sha::K[i] + w[i][l];
+                        const uint32_t t2 = (sha::rotr(a[l], 2) ^ sha::rotr(a[l], 13) ^ sha::rotr(a[l], 22)) + ((a[l] & b[l]) ^ (a[l] & c[l]) ^ (b[l] & c[l]));
+
+                        h[l] = g[l]; g[l] = f[l]; f[l] = e[l]; e[l] = d[l] + t1;
+                        d[l] = c[l]; c[l] = b[l]; b[l] = a[l]; a[l] = t1 + t2;
+                    }
+                }
+
+                for (size_t l = 0; l < LANES; ++l) {
+                    _state[0][l] += a[l]; _state[1][l] += b[l]; _state[2][l] += c[l]; _state[3][l] += d[l];
+                    _state[4][l] += e[l]; _state[5][l] += f[l]; _state[6][l] += g[l]; _state[7][l] += h[l];
+                }
+            }
+
+        public:
+            // Hash X messages of Y bytes each
+            static void hash(const uint8_t* const* _messages, const size_t _count, const size_t _size, sha256::digest_t* _out) noexcept
+            {
+                const size_t full_blocks = _size / 64;
+                const size_t tail = _size % 64;
+                const size_t tail_blocks = (tail + 9 > 64) ? 2 : 1;
+                const uint64_t bits = static_cast<uint64_t>(_size) * 8;
+
+                for (size_t group = 0; group < _count; group += LANES)
+                {
+                    // Unused lanes of the last group repeat the last message, their result is dropped
+                    const uint8_t* messages[LANES];
+                    uint8_t padded[LANES][128];
+                    lanes_t state[8];
+
+                    for (size_t l = 0; l < LANES; ++l)
+                    {
+                        messages[l] = _messages[std::min(group + l, _count - 1)];
+
+                        std::memset(padded[l], 0, sizeof(padded[l]));
+                        std::memcpy(padded[l], messages[l] + full_blocks * 64, tail);
+                        padded[l][tail] = 0x80;
+
+                        for (uint32_t i = 0; i < 8; ++i) {
+                            padded[l][tail_blocks * 64 - 1 - i] = static_cast<uint8_t>(bits >> (i * 8));
+                        }
+
+                        for (uint32_t i = 0; i < 8; ++i) {
+                            state[i][l] = sha256::H0[i];
+                        }
+                    }
+
+                    const uint8_t* blocks[LANES];
+
+                    for (size_t block = 0; block < full_blocks; ++block)
+                    {
+                        for (size_t l = 0; l < LANES; ++l) {
+                            blocks[l] = messages[l] + block * 64;
+                        }
+
+                        compress(state, blocks);
+                    }
+
+                    for (size_t block = 0; block < tail_blocks; ++block)
+                    {
+                        for (size_t l = 0; l < LANES; ++l) {
+                            blocks[l] = padded[l] + block * 64;
+                        }
+
+                        compress(state, blocks);
+                    }
+
+                    for (size_t l = 0; l < LANES && group + l < _count; ++l) {
+                        for (uint32_t i = 0; i < 8; ++i) {
+                            sha256::store_be32(_out[group + l].data() + i * 4, state[i][l]);
+                        }
+                    }
+                }
+            }
+        };
+
+        // MGF1 with SHA-256 for X seeds of the same size (seed i starts at _seeds + i * _stride), Y mask bytes per seed
+        _NODISCARD inline std::vector<uint8_t> mgf1_sha256(const uint8_t* _seeds, const size_t _seed_size, const size_t _stride, const size_t _count, const size_t _mask_size)
+        {
+            const size_t per_seed = (_mask_size + 31) / 32;
+            const size_t input_size = _seed_size + 4;
+
+            // Every input is seed || counter, so all of them have the same length and can be hashed together
+            std::vector<uint8_t> inputs(_count * per_seed * input_size);
+            std::vector<const uint8_t*> messages(_count * per_seed);
+
+            for (size_t i = 0; i < _count; ++i) {
+                for (size_t j = 0; j < per_seed; ++j)
+                {
+                    uint8_t* input = inputs.data() + (i * per_seed + j) * input_size;
+
+                    std::memcpy(input, _seeds + i * _stride, _seed_size);
+                    sha256::store_be32(input + _seed_size, static_cast<uint32_t>(j));
+
+                    messages[i * per_seed + j] = input;
+                }
+            }
+
+            std::vector<sha256::digest_t> hashes(messages.size());
+            sha256_multi::hash(messages.data(), messages.size(), input_size, hashes.data());
+
+            std::vector<uint8_t> masks(_count * _mask_size);
+
+            for (size_t i = 0; i < _count; ++i) {
+                for (size_t j = 0; j < per_seed; ++j) {
+                    const size_t offset = j * 32;
+                    std::memcpy(masks.data() + i * _mask_size + offset, hashes[i * per_seed + j].data(), std::min<size_t>(32, _mask_size - offset));
+                }
+            }
+
+            return masks;
+        }
+
+        // Amount of bytes needed to store X
+        _NODISCARD inline size_t byte_length(const number_t& _num) noexcept
+        {
+            return _num.is_zero() ? 0 : boost::multiprecision::msb(_num) / 8 + 1;
+        }
+
+        // Wide strings to UTF-8 for the byte oriented modes, 2 byte code units are read as UTF-16 and 4 byte ones as
+        // UTF-32. Unpaired surrogates are kept as 3 byte sequences (WTF-8), so every string comes back unchanged.
+        // Runs of ASCII are checked and narrowed one 64 bit word at a time, false for code points past U+10FFFF
+        template <class char_type>
+        _NODISCARD bool to_utf8(const char_type* _data, const size_t _size, std::string& _out)
+        {
+            static_assert(sizeof(char_type) == 2 || sizeof(char_type) == 4, "UTF-8 conversion is only for wide strings");
+
+            using unit_t = std::conditional_t<sizeof(char_type) == 2, uint16_t, uint32_t>;
+
+            constexpr size_t per_word = 8 / sizeof(char_type);
+            constexpr uint64_t non_ascii = (sizeof(char_type) == 2) ? 0xff80ff80ff80ff80 : 0xffffff80ffffff80;
+
+            _out.clear();
+            _out.reserve(_size + _size / 4);
+
+            size_t i = 0;
+
+            while (i < _size)
+            {
+                for (uint64_t word; i + per_word <= _size; i += per_word)
+                {
+                    std::memcpy(&word, _data + i, sizeof(word));
+
+                    if ((word & non_ascii) != 0) {
+                        break;
+                    }
+
+                    for (size_t j = 0; j < per_word; ++j) {
+                        _out.push_back(static_cast<char>(_data[i + j]));
+                    }
+                }
+
+                if (i == _size) {
+                    break;
+                }
+
+                uint32_t code = static_cast<unit_t>(_data[i++]);
+
+                if constexpr (sizeof(char_type) == 2)
+                {
+                    if (code >= 0xd800 && code < 0xdc00 && i < _size)
+                    {
+                        const uint32_t low = static_cast<unit_t>(_data[i]);
+
+                        if (low >= 0xdc00 && low < 0xe000) {
+                            code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                            ++i;
+                        }
+                    }
+                }
+                else if (code > 0x10ffff) {
+                    return false;
+                }
+
+                if (code < 0x80) {
+                    _out.push_back(static_cast<char>(code));
+                }
+                else if (code < 0x800) {
+                    _out.push_back(static_cast<char>(0xc0 | (code >> 6)));
+                    _out.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+                }
+                else if (code < 0x10000) {
+                    _out.push_back(static_cast<char>(0xe0 | (code >> 12)));
+                    _out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+                    _out.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+                }
+                else {
+                    _out.push_back(static_cast<char>(0xf0 | (code >> 18)));
+                    _out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3f)));
+                    _out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+                    _out.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+                }
+            }
+
+            return true;
+        }
+
+        // UTF-8 from to_utf8() back to a wide string, false for malformed or overlong sequences
+        template <class char_type>
+        _NODISCARD bool from_utf8(const uint8_t* _data, const size_t _size, std::basic_string<char_type>& _out)
+        {
+            constexpr uint32_t minimum[5] = { 0, 0, 0x80, 0x800, 0x10000 };
+
+            _out.clear();
+            _out.reserve(_size);
+
+            size_t i = 0;
+
+            while (i < _size)
+            {
+                for (uint64_t word; i + 8 <= _size; i += 8)
+                {
+                    std::memcpy(&word, _data + i, sizeof(word));
+
+                    if ((word & 0x8080808080808080) != 0) {
+                        break;
+                    }
+
+                    for (size_t j = 0; j < 8; ++j) {
+                        _out.push_back(static_cast<char_type>(_data[i + j]));
+                    }
+                }
+
+                if (i == _size) {
+                    break;
+                }
+
+                const uint8_t lead = _data[i];
+
+                uint32_t code = 0;
+                size_t length = 0;
+
+                if (lead < 0x80) {
+                    code = lead; length = 1;
+                }
+                else if ((lead & 0xe0) == 0xc0) {
+                    code = lead & 0x1f; length = 2;
+                }
+                else if ((lead & 0xf0) == 0xe0) {
+                    code = lead & 0x0f; length = 3;
+                }
+                else if ((lead & 0xf8) == 0xf0) {
+                    code = lead & 0x07; length = 4;
+                }
+                else {
+                    return false;
+                }
+
+                if (i + length > _size) {
+                    return false;
+                }
+
+                for (size_t j = 1; j < length; ++j)
+                {
+                    if ((_data[i + j] & 0xc0) != 0x80) {
+                        return false;
+                    }
+
+                    code = (code << 6) | (_data[i + j] & 0x3f);
+                }
+
+                if (code < minimum[length] || code > 0x10ffff) {
+                    return false;
+                }
+
+                i += length;
+
+                if (sizeof(char_type) == 2 && code >= 0x10000) {
+                    code -= 0x10000;
+                    _out.push_back(static_cast<char_type>(0xd800 + (code >> 10)));
+                    _out.push_back(static_cast<char_type>(0xdc00 + (code & 0x3ff)));
+                }
+                else {
+                    _out.push_back(static_cast<char_type>(code));
+                }
+            }
+
+            return true;
+        }
+
+        // LZ77 compression in LZ4 style sequences: token (literal length << 4 | match length - 4), literals,
+        // 2 byte little endian offset, lengths of 15 and more continue in 255 steps. The original size comes first
+        // as LEB128. Matches are found greedily with a hash table of 4 byte sequences
+        inline std::vector<uint8_t> lz_compress(const uint8_t* _data, const size_t _size)
+        {
+            constexpr uint32_t hash_bits = 14;
+            constexpr size_t min_match = 4;
+
+            std::vector<uint8_t> out; out.reserve(_size / 2 + 16);
+
+            for (uint64_t size = _size; ; size >>= 7)
+            {
+                if (size < 0x80) {
+                    out.push_back(static_cast<uint8_t>(size));
+                    break;
+                }
+
+                out.push_back(static_cast<uint8_t>(0x80 | (size & 0x7f)));
+            }
+
+            auto load32 = [_data](const size_t _pos) -> uint32_t
+            {
+                uint32_t value;
+                std::memcpy(&value, _data + _pos, sizeof(value));
+                return value;
+            };
+
+            auto push_length = [&out](size_t _length)
+            {
+                for (; _length >= 255; _length -= 255) {
+                    out.push_back(255);
+                }
+
+                out.push_back(static_cast<uint8_t>(_length));
+            };
+
+            auto push_literals = [&out, &push_length, _data](const size_t _begin, const size_t _end, const uint8_t _match)
+            {
+                const size_t length = _end - _begin;
+
+                out.push_back(static_cast<uint8_t>((std::min<size_t>(length, 15) << 4) | _match));
+
+                if (length >= 15) {
+                    push_length(length - 15);
+                }
+
+                out.insert(out.end(), _data + _begin, _data + _end);
+            };
+
+            // Position + 1 of the last 4 byte sequence with this hash, 0 for none
+            std::vector<uint32_t> table(size_t(1) << hash_bits, 0);
+
+            // The last 12 bytes are always literals, like in LZ4
+            const size_t limit = (_size > 12) ? _size - 12 : 0;
+
+            size_t anchor = 0;
+            size_t i = 0;
+
+            while (i < limit)
+            {
+                const uint32_t sequence = load32(i);
+                const uint32_t hash = (sequence * 2654435761u) >> (32 - hash_bits);
+                const size_t candidate = table[hash];
+
+                table[hash] = static_cast<uint32_t>(i + 1);
+
+                if (candidate == 0 || i - (candidate - 1) > 0xffff || load32(candidate - 1) != sequence) {
+                    ++i;
+                    continue;
+                }
+
+                const size_t match = candidate - 1;
+                size_t length = min_match;
+
+                while (i + length < _size - 5 && _data[match + length] == _data[i + length]) {
+                    ++length;
+                }
+
+                const size_t extra = length - min_match;
+                const size_t offset = i - match;
+
+                push_literals(anchor, i, static_cast<uint8_t>(std::min<size_t>(extra, 15)));
+
+                out.push_back(static_cast<uint8_t>(offset & 0xff));
+                out.push_back(static_cast<uint8_t>(offset >> 8));
+
+                if (extra >= 15) {
+                    push_length(extra - 15);
+                }
+
+                i += length;
+                anchor = i;
+            }
+
+            push_literals(anchor, _size, 0);
+
+            return out;
+        }
+
+        // Back from lz_compress(), false for damaged input
+        _NODISCARD inline bool lz_decompress(const uint8_t* _data, const size_t _size, std::vector<uint8_t>& _out)
+        {
+            size_t pos = 0;
+            uint64_t size = 0;
+
+            for (uint32_t shift = 0; ; shift += 7)
+            {
+                if (pos == _size || shift > 35) {
+                    return false;
+                }
+
+                const uint8_t byte = _data[pos++];
+                size |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+                if ((byte & 0x80) == 0) {
+                    break;
+                }
+            }
+
+            auto read_length = [_data, _size, &pos](size_t& _length) -> bool
+            {
+                while (true)
+                {
+                    if (pos == _size) {
+                        return false;
+                    }
+
+                    const uint8_t byte = _data[pos++];
+                    _length += byte;
+
+                    if (byte != 255) {
+                        return true;
+                    }
+                }
+            };
+
+            _out.clear();
+            _out.reserve(static_cast<size_t>(std::min<uint64_t>(size, uint64_t(_size) * 256)));
+
+            while (pos < _size)
+            {
+                const uint8_t token = _data[pos++];
+
+                size_t literals = token >> 4;
+
+                if (literals == 15 && !read_length(literals)) {
+                    return false;
+                }
+
+                if (literals > _size - pos || _out.size() + literals > size) {
+                    return false;
+                }
+
+                _out.insert(_out.end(), _data + pos, _data + pos + literals);
+                pos += literals;
+
+                // The last sequence has no match
+                if (pos == _size) {
+                    break;
+                }
+
+                if (_size - pos < 2) {
+                    return false;
+                }
+
+                const size_t offset = _data[pos] | (static_cast<size_t>(_data[pos + 1]) << 8);
+                pos += 2;
+
+                size_t length = token & 0x0f;
+
+                if (length == 15 && !read_length(length)) {
+                    return false;
+                }
+
+                length += 4;
+
+                if (offset == 0 || offset > _out.size() || _out.size() + length > size) {
+                    return false;
+                }
+
+                // The match can overlap the bytes it produces, so it is copied byte by byte
+                const size_t from = _out.size() - offset;
+
+                for (size_t j = 0; j < length; ++j) {
+                    _out.push_back(_out[from + j]);
+                }
+            }
+
+            return _out.size() == size;
+        }
+
+        // Big endian bytes to number
+        _NODISCARD inline number_t from_bytes(const uint8_t* _data, const size_t _size)
+        {
+            number_t result;
+            boost::multiprecision::import_bits(result, _data, _data + _size, 8, true);
+            return result;
+        }
+
+        // Big endian bytes to X, reuses the limbs X already has
+        inline void from_bytes(const uint8_t* _data, const size_t _size, number_t& _out)
+        {
+            boost::multiprecision::import_bits(_out, _data, _data + _size, 8, true);
+        }
+
+        // Number to big endian bytes with a fixed length, false if it doesn`t fit
+        inline bool to_bytes(const number_t& _num, uint8_t* _out, const size_t _size) noexcept
+        {
+            const size_t len = byte_length(_num);
+
+            if (len > _size) {
+                return false;
+            }
+
+            std::memset(_out, 0, _size - len);
+
+            if (len != 0) {
+                boost::multiprecision::export_bits(_num, _out + (_size - len), 8, true);
+            }
+
+            return true;
+        }
+
+        // Key fingerprint: SHA-256 of n as big endian bytes
+        _NODISCARD inline std::array<uint8_t, 32> key_fingerprint(const number_t& _n)
+        {
+            std::vector<uint8_t> bytes(byte_length(_n));
+            to_bytes(_n, bytes.data(), bytes.size());
+
+            return sha256::hash(bytes.data(), bytes.size());
+        }
+
+        _NODISCARD inline uint32_t load_le32(const uint8_t* _ptr) noexcept
+        {
+            return static_cast<uint32_t>(_ptr[0]) | (static_cast<uint32_t>(_ptr[1]) << 8) | (static_cast<uint32_t>(_ptr[2]) << 16) | (static_cast<uint32_t>(_ptr[3]) << 24);
+        }
+
+        inline void store_le32(uint8_t* _ptr, const uint32_t _x) noexcept
+        {
+            _ptr[0] = static_cast<uint8_t>(_x);
+            _ptr[1] = static_cast<uint8_t>(_x >> 8);
+            _ptr[2] = static_cast<uint8_t>(_x >> 16);
+            _ptr[3] = static_cast<uint8_t>(_x >> 24);
+        }
+
+        // KDF2 with SHA-256, derive X bytes from a shared secret
+        inline void kdf_sha256(const uint8_t* _secret, const size_t _size, uint8_t* _out, size_t _out_size) noexcept
+        {
+            for (uint32_t counter = 1; _out_size != 0; ++counter)
+            {
+                uint8_t be_counter[4];
+                sha256::store_be32(be_counter, counter);
+
+                const auto hash = sha256().update(_secret, _size).update(be_counter, sizeof(be_counter)).final();
+                const size_t take = std::min(_out_size, hash.size());
+
+                std::memcpy(_out, hash.data(), take);
+                _out += take;
+                _out_size -= take;
+            }
+        }
+
+        // OR of the XOR of two buffers, 0 if they are equal, in constant time
+        _NODISCARD inline uint8_t diff_ct(const uint8_t* _a, const uint8_t* _b, const size_t _size) noexcept
+        {
+            uint8_t diff = 0;
+
+            for (size_t i = 0; i < _size; ++i) {
+                diff |= _a[i] ^ _b[i];
+            }
+
+            return diff;
+        }
+
+        // Compare two buffers in constant time
+        _NODISCARD inline bool equal_ct(const uint8_t* _a, const uint8_t* _b, const size_t _size) noexcept
+        {
+            return diff_ct(_a, _b, _size) == 0;
+        }
+
+        // All bits set if X is 0, otherwise 0, without a branch
+        _NODISCARD constexpr size_t zero_mask_ct(const size_t _value) noexcept
+        {
+            return ((_value | (0 - _value)) >> (std::numeric_limits<size_t>::digits - 1)) - 1;
+        }
+
+        // Y where the mask X is set, otherwise Z, without a branch
+        _NODISCARD constexpr size_t select_ct(const size_t _mask, const size_t _a, const size_t _b) noexcept
+        {
+            return (_a & _mask) | (_b & ~_mask);
+        }
+
+        // Fill a buffer with random bytes from the system random source
+        inline void random_bytes(uint8_t* _out, const size_t _size)
+        {
+            std::random_device rd;
+
+            for (size_t i = 0; i < _size; i += sizeof(uint32_t))
+            {
+                const uint32_t value = rd();
+                std::memcpy(_out + i, &value, std::min(sizeof(uint32_t), _size - i));
+            }
+        }
+
+        // ChaCha20 stream cipher (RFC 8439)
+        class chacha20
+        {
+        private:
+            uint32_t m_state[16];
+
+            _NODISCARD static constexpr uint32_t rotl(const uint32_t _x, const uint32_t _n) noexcept
+            {
+                return (_x << _n) | (_x >> (32 - _n));
+            }
+
+            // Quarter round on 4 independent blocks at once, written lane by lane so it vectorizes
+            static void quarter_round(uint32_t (&a)[4], uint32_t (&b)[4], uint32_t (&c)[4], uint32_t (&d)[4]) noexcept
+            {
+                for (uint32_t l = 0; l < 4; ++l) { a[l] += b[l]; d[l] ^= a[l]; d[l] = rotl(d[l], 16); }
+                for (uint32_t l = 0; l < 4; ++l) { c[l] += d[l]; b[l] ^= c[l]; b[l] = rotl(b[l], 12); }
+                for (uint32_t l = 0; l < 4; ++l) { a[l] += b[l]; d[l] ^= a[l]; d[l] = rotl(d[l], 8); }
+                for (uint32_t l = 0; l < 4; ++l) { c[l] += d[l]; b[l] ^= c[l]; b[l] = rotl(b[l], 7); }
+            }
+
+            // Generate the next 4 blocks (256 bytes) of key stream
+            void block4(uint8_t* _out) noexcept
+            {
+                uint32_t input[16][4], x[16][4];
+
+                for (uint32_t i = 0; i < 16; ++i) {
+                    for (uint32_t l = 0; l < 4; ++l) {
+                        input[i][l] = m_state[i];
+                    }
+                }
+
+                for (uint32_t l = 0; l < 4; ++l) {
+                    input[12][l] += l;
+                }
+
+                std::memcpy(x, input, sizeof(x));
+
+                for (uint32_t i = 0; i < 10; ++i)
+                {
+                    quarter_round(x[0], x[4], x[8], x[12]);
+                    quarter_round(x[1], x[5], x[9], x[13]);
+                    quarter_round(x[2], x[6], x[10], x[14]);
+                    quarter_round(x[3], x[7], x[11], x[15]);
+                    quarter_round(x[0], x[5], x[10], x[15]);
+                    quarter_round(x[1], x[6], x[11], x[12]);
+                    quarter_round(x[2], x[7], x[8], x[13]);
+                    quarter_round(x[3], x[4], x[9], x[14]);
+                }
+
+                for (uint32_t l = 0; l < 4; ++l) {
+                    for (uint32_t i = 0; i < 16; ++i) {
+                        store_le32(_out + l * 64 + i * 4, x[i][l] + input[i][l]);
+                    }
+                }
+
+                m_state[12] += 4;
+            }
+
+        public:
+            chacha20(const uint8_t* _key, const uint8_t* _nonce, const uint32_t _counter = 0) noexcept
+            {
+                m_state[0] = 0x61707865;
+                m_state[1] = 0x3320646e;
+                m_state[2] = 0x79622d32;
+                m_state[3] = 0x6b206574;
+
+                for (uint32_t i = 0; i < 8; ++i) {
+                    m_state[4 + i] = load_le32(_key + i * 4);
+                }
+
+                m_state[12] = _counter;
+
+                for (uint32_t i = 0; i < 3; ++i) {
+                    m_state[13 + i] = load_le32(_nonce + i * 4);
+                }
+            }
+
+            // XOR the key stream into a buffer, a call after a partial 256 byte chunk continues at the next chunk
+            void apply(uint8_t* _data, size_t _size) noexcept
+            {
+                uint8_t stream[256];
+
+                while (_size != 0)
+                {
+                    block4(stream);
+
+                    const size_t take = std::min(_size, sizeof(stream));
+
+                    for (size_t i = 0; i < take; ++i) {
+                        _data[i] ^= stream[i];
+                    }
+
+                    _data += take;
+                    _size -= take;
+                }
+            }
+        };
+
+        // Poly1305 one-time authenticator (RFC 8439), 26 bit limbs so it needs no 128 bit integers
+        class poly1305
+        {
+        private:
+            uint32_t m_r[5], m_h[5] = { }, m_pad[4];
+            uint8_t m_buffer[16] = { };
+            size_t m_fill = 0;
+
+            void blocks(const uint8_t* _data, size_t _size, const uint32_t _hibit) noexcept
+            {
+                const uint32_t r0 = m_r[0], r1 = m_r[1], r2 = m_r[2], r3 = m_r[3], r4 = m_r[4];
+                const uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+
+                uint32_t h0 = m_h[0], h1 = m_h[1], h2 = m_h[2], h3 = m_h[3], h4 = m_h[4];
+
+                for (; _size >= 16; _data += 16, _size -= 16)
+                {
+                    h0 += (load_le32(_data + 0)) & 0x3ffffff;
+                    h1 += (load_le32(_data + 3) >> 2) & 0x3ffffff;
+                    h2 += (load_le32(_data + 6) >> 4) & 0x3ffffff;
+                    h3 += (load_le32(_data + 9) >> 6) & 0x3ffffff;
+                    h4 += (load_le32(_data + 12) >> 8) | _hibit;
+
+                    const uint64_t d0 = uint64_t(h0) * r0 + uint64_t(h1) * s4 + uint64_t(h2) * s3 + uint64_t(h3) * s2 + uint64_t(h4) * s1;
+                    uint64_t d1 = uint64_t(h0) * r1 + uint64_t(h1) * r0 + uint64_t(h2) * s4 + uint64_t(h3) * s3 + uint64_t(h4) * s2;
+                    uint64_t d2 = uint64_t(h0) * r2 + uint64_t(h1) * r1 + uint64_t(h2) * r0 + uint64_t(h3) * s4 + uint64_t(h4) * s3;
+                    uint64_t d3 = uint64_t(h0) * r3 + uint64_t(h1) * r2 + uint64_t(h2) * r1 + uint64_t(h3) * r0 + uint64_t(h4) * s4;
+                    uint64_t d4 = uint64_t(h0) * r4 + uint64_t(h1) * r3 + uint64_t(h2) * r2 + uint64_t(h3) * r1 + uint64_t(h4) * r0;
+
+                    uint32_t c = static_cast<uint32_t>(d0 >> 26); h0 = static_cast<uint32_t>(d0) & 0x3ffffff;
+                    d1 += c; c = static_cast<uint32_t>(d1 >> 26); h1 = static_cast<uint32_t>(d1) & 0x3ffffff;
+                    d2 += c; c = static_cast<uint32_t>(d2 >> 26); h2 = static_cast<uint32_t>(d2) & 0x3ffffff;
+                    d3 += c; c = static_cast<uint32_t>(d3 >> 26); h3 = static_cast<uint32_t>(d3) & 0x3ffffff;
+                    d4 += c; c = static_cast<uint32_t>(d4 >> 26); h4 = static_cast<uint32_t>(d4) & 0x3ffffff;
+                    h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+                    h1 += c;
+                }
+
+                m_h[0] = h0; m_h[1] = h1; m_h[2] = h2; m_h[3] = h3; m_h[4] = h4;
+            }
+
+        public:
+            explicit poly1305(const uint8_t* _key) noexcept
+            {
+                m_r[0] = (load_le32(_key + 0)) & 0x3ffffff;
+                m_r[1] = (load_le32(_key + 3) >> 2) & 0x3ffff03;
+                m_r[2] = (load_le32(_key + 6) >> 4) & 0x3ffc0ff;
+                m_r[3] = (load_le32(_key + 9) >> 6) & 0x3f03fff;
+                m_r[4] = (load_le32(_key + 12) >> 8) & 0x00fffff;
+
+                for (uint32_t i = 0; i < 4; ++i) {
+                    m_pad[i] = load_le32(_key + 16 + i * 4);
+                }
+            }
+
+            // Add data to the authenticator
+            poly1305& update(const void* _data, size_t _size) noexcept
+            {
+                const uint8_t* ptr = static_cast<const uint8_t*>(_data);
+
+                if (m_fill != 0)
+                {
+                    const size_t take = std::min(16 - m_fill, _size);
+
+                    std::memcpy(m_buffer + m_fill, ptr, take);
+                    m_fill += take;
+                    ptr += take;
+                    _size -= take;
+
+                    if (m_fill != 16) {
+                        return *this;
+                    }
+
+                    blocks(m_buffer, 16, 1 << 24);
+                    m_fill = 0;
+                }
+
+                const size_t full = _size & ~size_t(15);
+
+                blocks(ptr, full, 1 << 24);
+
+                if (_size != full) {
+                    std::memcpy(m_buffer, ptr + full, _size - full);
+                    m_fill = _size - full;
+                }
+
+                return *this;
+            }
+
+            // Finish and return the 16 byte tag
+            _NODISCARD std::array<uint8_t, 16> final() noexcept
+            {
+                if (m_fill != 0)
+                {
+                    m_buffer[m_fill] = 1;
+                    std::memset(m_buffer + m_fill + 1, 0, 15 - m_fill);
+                    blocks(m_buffer, 16, 0);
+                }
+
+                uint32_t h0 = m_h[0], h1 = m_h[1], h2 = m_h[2], h3 = m_h[3], h4 = m_h[4];
+
+                uint32_t c = h1 >> 26; h1 &= 0x3ffffff;
+                h2 += c; c = h2 >> 26; h2 &= 0x3ffffff;
+                h3 += c; c = h3 >> 26; h3 &= 0x3ffffff;
+                h4 += c; c = h4 >> 26; h4 &= 0x3ffffff;
+                h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+                h1 += c;
+
+                // Compute h - p and select it if h >= p
+                uint32_t g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+                uint32_t g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+                uint32_t g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+                uint32_t g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+                uint32_t g4 = h4 + c - (1u << 26);
+
+                uint32_t mask = (g4 >> 31) - 1;
+                h0 = (h0 & ~mask) | (g0 & mask);
+                h1 = (h1 & ~mask) | (g1 & mask);
+                h2 = (h2 & ~mask) | (g2 & mask);
+                h3 = (h3 & ~mask) | (g3 & mask);
+                h4 = (h4 & ~mask) | (g4 & mask);
+
+                const uint32_t w[4] = {
+                    h0 | (h1 << 26),
+                    (h1 >> 6) | (h2 << 20),
+                    (h2 >> 12) | (h3 << 14),
+                    (h3 >> 18) | (h4 << 8)
+                };
+
+                std::array<uint8_t, 16> tag;
+                uint64_t f = 0;
+
+                for (uint32_t i = 0; i < 4; ++i) {
+                    f = uint64_t(w[i]) + m_pad[i] + (f >> 32);
+                    store_le32(tag.data() + i * 4, static_cast<uint32_t>(f));
+                }
+
+                return tag;
+            }
+        };
+
+        // Tag of a ChaCha20-Poly1305 ciphertext without additional data (RFC 8439)
+        _NODISCARD inline std::array<uint8_t, 16> aead_tag(const uint8_t* _key, const uint8_t* _nonce, const uint8_t* _data, const size_t _size) noexcept
+        {
+            uint8_t poly_key[32] = { };
+            chacha20(_key, _nonce, 0).apply(poly_key, sizeof(poly_key));
+
+            const uint8_t zeros[16] = { };
+            uint8_t lengths[16] = { };
+
+            store_le32(lengths + 8, static_cast<uint32_t>(static_cast<uint64_t>(_size)));
+            store_le32(lengths + 12, static_cast<uint32_t>(static_cast<uint64_t>(_size) >> 32));
+
+            return poly1305(poly_key).update(_data, _size).update(zeros, (16 - _size % 16) % 16).update(lengths, sizeof(lengths)).final();
+        }
+
+        // Modular inverse of X mod Y with the iterative extended Euclidean algorithm, false if there is none
+        inline bool inverse_mod(const number_t& _num, const number_t& _mod, number_t& _inverse)
+        {
+            number_t t = 0, new_t = 1, r = _mod, new_r = _num % _mod;
+
+            while (new_r != 0)
+            {
+                const number_t quotient = r / new_r;
+
+                t = t - quotient * new_t;
+                std::swap(t, new_t);
+
+                r = r - quotient * new_r;
+                std::swap(r, new_r);
+            }
+
+            if (r != 1) {
+                return false;
+            }
+
+            _inverse = (t < 0) ? t + _mod : t;
+
+            return true;
+        }
+
+        _NODISCARD inline uint64_t load_le64(const uint8_t* _ptr) noexcept
+        {
+            return static_cast<uint64_t>(load_le32(_ptr)) | (static_cast<uint64_t>(load_le32(_ptr + 4)) << 32);
+        }
+
+        inline void store_le64(uint8_t* _ptr, const uint64_t _x) noexcept
+        {
+            store_le32(_ptr, static_cast<uint32_t>(_x));
+            store_le32(_ptr + 4, static_cast<uint32_t>(_x >> 32));
+        }
+
+        // FNV-1a 64 bit checksum
+        _NODISCARD inline uint64_t fnv1a64(const uint8_t* _data, const size_t _size) noexcept
+        {
+            uint64_t hash = 0xcbf29ce484222325;
+
+            for (size_t i = 0; i < _size; ++i) {
+                hash = (hash ^ _data[i]) * 0x100000001b3;
+            }
+
+            return hash;
+        }
+
+        // Read only memory mapping of a whole file
+        class mapped_file
+        {
+        private:
+            const uint8_t* m_data = nullptr;
+            size_t m_size = 0;
+
+#ifdef _WIN32
+            HANDLE m_file = INVALID_HANDLE_VALUE;
+            HANDLE m_mapping = nullptr;
+#endif
+
+        public:
+            mapped_file() = default;
+
+            explicit mapped_file(const std::string_view& _filename)
+            {
+                open(_filename);
+            }
+
+            mapped_file(const mapped_file&) = delete;
+            mapped_file& operator=(const mapped_file&) = delete;
+
+            mapped_file(mapped_file&& _other) noexcept
+            {
+                *this = std::move(_other);
+            }
+
+            mapped_file& operator=(mapped_file&& _other) noexcept
+            {
+                if (this != &_other)
+                {
+                    close();
+
+                    std::swap(m_data, _other.m_data);
+                    std::swap(m_size, _other.m_size);
+#ifdef _WIN32
+                    std::swap(m_file, _other.m_file);
+                    std::swap(m_mapping, _other.m_mapping);
+#endif
+                }
+
+                return *this;
+            }
+
+            ~mapped_file()
+            {
+                close();
+            }
+
+            // Map a file, false if it can`t be opened or is empty
+            bool open(const std::string_view& _filename)
+            {
+                close();
+
+                const std::string filename(_filename);
+
+#ifdef _WIN32
+                m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+                if (m_file == INVALID_HANDLE_VALUE) {
+                    return false;
+                }
+
+                LARGE_INTEGER size;
+
+                if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) {
+                    close();
+                    return false;
+                }
+
+                m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+                if (m_mapping == nullptr) {
+                    close();
+                    return false;
+                }
+
+                m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+                m_size = static_cast<size_t>(size.QuadPart);
+#else
+                const int fd = ::open(filename.c_str(), O_RDONLY);
+
+                if (fd < 0) {
+                    return false;
+                }
+
+                struct stat info;
+
+                if (fstat(fd, &info) != 0 || info.st_size == 0) {
+                    ::close(fd);
+                    return false;
+                }
+
+                void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+
+                // The mapping stays valid after the descriptor is closed
+                ::close(fd);
+
+                if (data == MAP_FAILED) {
+                    return false;
+                }
+
+                m_data = static_cast<const uint8_t*>(data);
+                m_size = static_cast<size_t>(info.st_size);
+#endif
+
+                if (m_data == nullptr) {
+                    close();
+                    return false;
+                }
+
+                return true;
+            }
+
+            void close() noexcept
+            {
+#ifdef _WIN32
+                if (m_data != nullptr) {
+                    UnmapViewOfFile(m_data);
+                }
+
+                if (m_mapping != nullptr) {
+                    CloseHandle(m_mapping);
+                }
+
+                if (m_file != INVALID_HANDLE_VALUE) {
+                    CloseHandle(m_file);
+                }
+
+                m_mapping = nullptr;
+                m_file = INVALID_HANDLE_VALUE;
+#else
+                if (m_data != nullptr) {
+                    munmap(const_cast<uint8_t*>(m_data), m_size);
+                }
+#endif
+
+                m_data = nullptr;
+                m_size = 0;
+            }
+
+            _NODISCARD const uint8_t* data() const noexcept
+            {
+                return m_data;
+            }
+
+            _NODISCARD size_t size() const noexcept
+            {
+                return m_size;
+            }
+
+            _NODISCARD explicit operator bool() const noexcept
+            {
+                return m_data != nullptr;
+            }
+        };
+
+        // Append a number as limb count and little endian 64 bit limbs
+        inline void write_limbs(std::vector<uint8_t>& _out, const number_t& _num)
+        {
+            std::vector<uint64_t> limbs;
+
+            if (!_num.is_zero()) {
+                boost::multiprecision::export_bits(_num, std::back_inserter(limbs), 64, false);
+            }
+
+            const size_t offset = _out.size();
+
+            _out.resize(offset + 8 + limbs.size() * 8);
+            store_le64(_out.data() + offset, limbs.size());
+
+            for (size_t i = 0; i < limbs.size(); ++i) {
+                store_le64(_out.data() + offset + 8 + i * 8, limbs[i]);
+            }
+        }
+
+        // Read a number written by write_limbs() straight from the limbs, false if the buffer is too short
+        inline bool read_limbs(const uint8_t*& _ptr, const uint8_t* _end, number_t& _num)
+        {
+            if (_end - _ptr < 8) {
+                return false;
+            }
+
+            const uint64_t count = load_le64(_ptr);
+
+            if (count > static_cast<uint64_t>(_end - _ptr - 8) / 8) {
+                return false;
+            }
+
+            // The limbs are read as bytes, so the mapping doesn`t have to be aligned
+            const uint8_t* limbs = _ptr + 8;
+
+            _num = 0;
+            boost::multiprecision::import_bits(_num, std::make_reverse_iterator(limbs + count * 8), std::make_reverse_iterator(limbs), 8, true);
+            _ptr += 8 + count * 8;
+
+            return true;
+        }
+
+        // Skip one limb record of a binary key without decoding it, false if it doesn`t fit before X
+        _NODISCARD inline bool skip_limbs(const uint8_t*& _ptr, const uint8_t* _end) noexcept
+        {
+            if (_end - _ptr < 8 || load_le64(_ptr) > static_cast<uint64_t>(_end - _ptr - 8) / 8) {
+                return false;
+            }
+
+            _ptr += 8 + load_le64(_ptr) * 8;
+
+            return true;
+        }
+
+        // Private parts of a binary key inside a mapped file, decoded on first use
+        class lazy_private
+        {
+        private:
+            std::shared_ptr<const mapped_file> m_owner;
+            const uint8_t* m_data;
+            const uint8_t* m_end;
+            std::once_flag m_once;
+
+        public:
+            number_t p, q, d, dp, dq, qinv;
+
+            // _data points at the limbs of p, q, n, d, dp, dq and qinv, the mapping is kept alive by _owner
+            lazy_private(std::shared_ptr<const mapped_file> _owner, const uint8_t* _data, const uint8_t* _end) noexcept : m_owner(std::move(_owner)), m_data(_data), m_end(_end)
+            {
+
+            }
+
+            // Decode the private parts once, safe to call from many threads. The layout was checked by the import,
+            // so a record that doesn`t fit means the mapping changed and no key with zero parts is left behind
+            void materialize()
+            {
+                std::call_once(m_once, [this]()
+                {
+                    const uint8_t* ptr = m_data;
+                    number_t n;
+
+                    for (number_t* num : { &p, &q, &n, &d, &dp, &dq, &qinv }) {
+                        if (!read_limbs(ptr, m_end, *num)) {
+                            throw std::runtime_error("The mapped binary key is corrupt");
+                        }
+                    }
+                });
+            }
+        };
+
+        // ASN.1 DER reader that walks the input in place, elements are returned as views into the same buffer
+        class der_reader
+        {
+        public:
+            constexpr static inline uint8_t INTEGER = 0x02;
+            constexpr static inline uint8_t BIT_STRING = 0x03;
+            constexpr static inline uint8_t OCTET_STRING = 0x04;
+            constexpr static inline uint8_t NULL_TAG = 0x05;
+            constexpr static inline uint8_t OBJECT_ID = 0x06;
+            constexpr static inline uint8_t SEQUENCE = 0x30;
+
+        private:
+            const uint8_t* m_ptr = nullptr;
+            const uint8_t* m_end = nullptr;
+
+        public:
+            der_reader() = default;
+
+            der_reader(const uint8_t* _data, const size_t _size) noexcept : m_ptr(_data), m_end(_data + _size)
+            {
+
+            }
+
+            _NODISCARD bool empty() const noexcept
+            {
+                return m_ptr == m_end;
+            }
+
+            _NODISCARD const uint8_t* data() const noexcept
+            {
+                return m_ptr;
+            }
+
+            _NODISCARD size_t size() const noexcept
+            {
+                return static_cast<size_t>(m_end - m_ptr);
+            }
+
+            // Tag of the next element, 0 if there is none
+            _NODISCARD uint8_t peek() const noexcept
+            {
+                return empty() ? 0 : *m_ptr;
+            }
+
+            // Read the next element with tag X, _content is a view of its content
+            bool read(const uint8_t _tag, der_reader& _content) noexcept
+            {
+                if (size() < 2 || m_ptr[0] != _tag) {
+                    return false;
+                }
+
+                const uint8_t* ptr = m_ptr + 2;
+                size_t length = m_ptr[1];
+
+                if (length & 0x80)
+                {
+                    const size_t bytes = length & 0x7f;
+
+                    // Indefinite lengths aren`t DER, more than 4 length bytes can`t be a key
+                    if (bytes == 0 || bytes > 4 || static_cast<size_t>(m_end - ptr) < bytes) {
+                        return false;
+                    }
+
+                    length = 0;
+
+                    for (size_t i = 0; i < bytes; ++i) {
+                        length = (length << 8) | *ptr++;
+                    }
+                }
+
+                if (static_cast<size_t>(m_end - ptr) < length) {
+                    return false;
+                }
+
+                _content = der_reader(ptr, length);
+                m_ptr = ptr + length;
+
+                return true;
+            }
+
+            // Read a non negative INTEGER, the number is built straight from the bytes in the buffer
+            bool integer(number_t& _num)
+            {
+                der_reader content;
+
+                if (!read(INTEGER, content) || content.empty() || (*content.m_ptr & 0x80)) {
+                    return false;
+                }
+
+                _num = from_bytes(content.m_ptr, content.size());
+
+                return true;
+            }
+
+            // Read a non negative INTEGER that fits into 32 bits
+            bool integer(uint32_t& _num) noexcept
+            {
+                der_reader content;
+
+                if (!read(INTEGER, content) || content.empty() || (*content.m_ptr & 0x80)) {
+                    return false;
+                }
+
+                while (content.size() > 1 && *content.m_ptr == 0) {
+                    ++content.m_ptr;
+                }
+
+                if (content.size() > 4) {
+                    return false;
+                }
+
+                _num = 0;
+
+                for (const uint8_t* ptr = content.m_ptr; ptr != content.m_end; ++ptr) {
+                    _num = (_num << 8) | *ptr;
+                }
+
+                return true;
+            }
+        };
+
+        // ASN.1 DER writer
+        class der_writer
+        {
+        private:
+            std::vector<uint8_t> m_data;
+
+        public:
+            _NODISCARD const std::vector<uint8_t>& data() const noexcept
+            {
+                return m_data;
+            }
+
+            // Append raw bytes of an already encoded element
+            der_writer& raw(const uint8_t* _data, const size_t _size)
+            {
+                m_data.insert(m_data.end(), _data, _data + _size);
+                return *this;
+            }
+
+            // Append an element with tag X and the given content
+            der_writer& element(const uint8_t _tag, const uint8_t* _content, const size_t _size)
+            {
+                m_data.push_back(_tag);
+
+                if (_size < 0x80) {
+                    m_data.push_back(static_cast<uint8_t>(_size));
+                }
+                else
+                {
+                    uint8_t bytes = 0;
+
+                    for (size_t size = _size; size != 0; size >>= 8) {
+                        ++bytes;
+                    }
+
+                    m_data.push_back(0x80 | bytes);
+
+                    for (uint8_t i = bytes; i-- > 0;) {
+                        m_data.push_back(static_cast<uint8_t>(_size >> (i * 8)));
+                    }
+                }
+
+                return raw(_content, _size);
+            }
+
+            der_writer& element(const uint8_t _tag, const der_writer& _content)
+            {
+                return element(_tag, _content.m_data.data(), _content.m_data.size());
+            }
+
+            // Append a non negative INTEGER
+            der_writer& integer(const number_t& _num)
+            {
+                const size_t len = byte_length(_num);
+
+                std::vector<uint8_t> bytes(len + 1, 0);
+                to_bytes(_num, bytes.data() + 1, len);
+
+                // Keep the leading zero if the top bit is set or the number is 0
+                const size_t skip = (len != 0 && (bytes[1] & 0x80) == 0) ? 1 : 0;
+
+                return element(der_reader::INTEGER, bytes.data() + skip, bytes.size() - skip);
+            }
+        };
+
+        // rsaEncryption AlgorithmIdentifier: SEQUENCE { OID 1.2.840.113549.1.1.1, NULL }
+        constexpr inline uint8_t RSA_ALGORITHM_ID[15] = {
+            0x30, 0x0d, 0x06, 0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x01, 0x01, 0x05, 0x00
+        };
+
+        // Base64 (RFC 4648) with line breaks every 64 characters for PEM
+        _NODISCARD inline std::string base64_encode(const uint8_t* _data, const size_t _size)
+        {
+            constexpr char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+            std::string result; result.reserve((_size + 2) / 3 * 4 + _size / 48 + 1);
+
+            for (size_t i = 0; i < _size; i += 3)
+            {
+                const uint32_t chunk = (static_cast<uint32_t>(_data[i]) << 16) | ((i + 1 < _size) ? (_data[i + 1] << 8) : 0) | ((i + 2 < _size) ? _data[i + 2] : 0);
+
+                result.push_back(alphabet[(chunk >> 18) & 0x3f]);
+                result.push_back(alphabet[(chunk >> 12) & 0x3f]);
+                result.push_back((i + 1 < _size) ? alphabet[(chunk >> 6) & 0x3f] : '=');
+                result.push_back((i + 2 < _size) ? alphabet[chunk & 0x3f] : '=');
+
+                if ((i / 3 + 1) % 16 == 0 && i + 3 < _size) {
+                    result.push_back('\n');
+                }
+            }
+
+            return result;
+        }
+
+        // Decode base64, whitespace is skipped, false on any other invalid character
+        inline bool base64_decode(const std::string_view& _text, std::vector<uint8_t>& _out)
+        {
+            _out.clear();
+            _out.reserve(_text.size() / 4 * 3);
+
+            uint32_t chunk = 0, bits = 0;
+            bool padding = false;
+
+            for (const char ch : _text)
+            {
+                uint32_t value;
+
+                if (ch >= 'A' && ch <= 'Z') value = ch - 'A';
+                else if (ch >= 'a' && ch <= 'z') value = ch - 'a' + 26;
+                else if (ch >= '0' && ch <= '9') value = ch - '0' + 52;
+                else if (ch == '+') value = 62;
+                else if (ch == '/') value = 63;
+                else if (ch == '=') { padding = true; continue; }
+                else if (ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t') continue;
+                else return false;
+
+                if (padding) {
+                    return false;
+                }
+
+                chunk = (chunk << 6) | value;
+                bits += 6;
+
+                if (bits >= 8) {
+                    bits -= 8;
+                    _out.push_back(static_cast<uint8_t>(chunk >> bits));
+                }
+            }
+
+            return true;
+        }
+
+        // CPUs this process may run on (sched_getaffinity), empty where that is not known
+        inline std::vector<uint32_t> allowed_cpus()
+        {
+            std::vector<uint32_t> cpus;
+
+#ifdef __linux__
+            cpu_set_t set;
+            CPU_ZERO(&set);
+
+            if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+                for (uint32_t i = 0; i < CPU_SETSIZE; ++i) {
+                    if (CPU_ISSET(i, &set)) {
+                        cpus.push_back(i);
+                    }
+                }
+            }
+#endif
+
+            return cpus;
+        }
+
+        // First line of a file, empty if it can't be read
+        inline std::string read_line(const std::string& _path)
+        {
+            std::ifstream file(_path);
+            std::string line;
+
+            std::getline(file, line);
+
+            return line;
+        }
+
+        // CPU limit of the cgroup of this process (v2 cpu.max, v1 cfs quota / period), 0 if there is none
+        inline double cgroup_cpu_limit()
+        {
+#ifdef __linux__
+            // "0::/path" for cgroup v2, "N:cpu,cpuacct:/path" for the v1 cpu controller
+            std::string v2_path, v1_path;
+            std::ifstream cgroups("/proc/self/cgroup");
+
+            for (std::string line; std::getline(cgroups, line);)
+            {
+                const size_t first = line.find(':');
+                const size_t second = line.find(':', first + 1);
+
+                if (first == std::string::npos || second == std::string::npos) {
+                    continue;
+                }
+
+                const std::string controllers = "," + line.substr(first + 1, second - first - 1) + ",";
+
+                if (controllers == ",," && line.compare(0, first, "0") == 0) {
+                    v2_path = line.substr(second + 1);
+                }
+                else if (controllers.find(",cpu,") != std::string::npos) {
+                    v1_path = line.substr(second + 1);
+                }
+            }
+
+            // "max" and -1 mean no limit
+            auto limit = [](const std::string& _quota, const std::string& _period) -> double
+            {
+                char* end = nullptr;
+                const double quota = std::strtod(_quota.c_str(), &end);
+                const double period = std::strtod(_period.c_str(), nullptr);
+
+                return (end != _quota.c_str() && quota > 0 && period > 0) ? quota / period : 0;
+            };
+
+            // Containers usually mount their own cgroup as the root, so the root is tried as well
+            for (const auto& dir : { "/sys/fs/cgroup" + v2_path, std::string("/sys/fs/cgroup") })
+            {
+                const std::string line = read_line(dir + "/cpu.max");
+                const size_t space = line.find(' ');
+
+                if (space != std::string::npos) {
+                    return limit(line.substr(0, space), line.substr(space + 1));
+                }
+            }
+
+            for (const auto& dir : { "/sys/fs/cgroup/cpu" + v1_path, "/sys/fs/cgroup/cpu,cpuacct" + v1_path, std::string("/sys/fs/cgroup/cpu") })
+            {
+                const std::string quota = read_line(dir + "/cpu.cfs_quota_us");
+
+                if (!quota.empty()) {
+                    return limit(quota, read_line(dir + "/cpu.cfs_period_us"));
+                }
+            }
+#endif
+
+            return 0;
+        }
+
+        // RSA_THREADS if it is set, otherwise the allowed CPUs capped by the cgroup CPU limit rounded up
+        inline uint32_t detect_thread_count()
+        {
+            if (const char* env = std::getenv("RSA_THREADS"))
+            {
+                const long count = std::strtol(env, nullptr, 10);
+
+                if (count > 0) {
+                    return static_cast<uint32_t>(count);
+                }
+            }
+
+            const size_t cpus = allowed_cpus().size();
+            uint32_t count = (cpus != 0) ? static_cast<uint32_t>(cpus) : std::thread::hardware_concurrency();
+
+            const double limit = cgroup_cpu_limit();
+
+            if (limit > 0) {
+                count = std::min(count, static_cast<uint32_t>(std::ceil(limit)));
+            }
+
+            return std::max(count, 1u);
+        }
+
+        // Worker settings of the library (see set_thread_count() and set_thread_pinning())
+        struct thread_settings
+        {
+            const uint32_t detected = detect_thread_count();
+            const std::vector<uint32_t> cpus = allowed_cpus();
+
+            std::atomic<uint32_t> count{ 0 };
+            std::atomic<bool> pinning{ std::getenv("RSA_PIN_THREADS") != nullptr && std::strcmp(std::getenv("RSA_PIN_THREADS"), "0") != 0 };
+
+            _NODISCARD uint32_t threads() const noexcept
+            {
+                const uint32_t set = count.load(std::memory_order_relaxed);
+                return (set != 0) ? set : detected;
+            }
+
+            _NODISCARD static thread_settings& get()
+            {
+                static thread_settings settings;
+                return settings;
+            }
+        };
+
+        // Pins the calling worker to one of the allowed CPUs, picked round robin by its index, false if pinning is off
+        inline bool pin_thread(const size_t _index) noexcept
+        {
+#ifdef __linux__
+            const auto& settings = thread_settings::get();
+
+            if (!settings.pinning.load(std::memory_order_relaxed) || settings.cpus.empty()) {
+                return false;
+            }
+
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(settings.cpus[_index % settings.cpus.size()], &set);
+
+            return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+            (void)_index;
+            return false;
+#endif
+        }
+
+        // Lanes of the library pool, urgent tasks (encrypt, decrypt, ...) always run before background ones (key generation)
+        enum class priority : uint8_t
+        {
+            urgent = 0,
+            background = 1
+        };
+
+        // Lane of the tasks the current thread submits, the pool sets it to the lane of the task it runs
+        inline thread_local priority current_priority = priority::urgent;
+
+        // Sets the lane of the tasks submitted in this scope
+        class priority_scope
+        {
+        private:
+            const priority m_last;
+
+        public:
+            explicit priority_scope(const priority _priority) noexcept : m_last(current_priority)
+            {
+                current_priority = _priority;
+            }
+
+            ~priority_scope()
+            {
+                current_priority = m_last;
+            }
+
+            priority_scope(const priority_scope&) = delete;
+            priority_scope& operator=(const priority_scope&) = delete;
+        };
+
+        // Worker threads shared by all keys with one work stealing deque per worker and lane. Workers take the back of
+        // their own deque and steal the front of the others, and look at every urgent deque before any background one
+        class thread_pool
+        {
+        private:
+            constexpr static inline size_t lanes = 2;
+
+            struct queue_t
+            {
+                std::mutex lock;
+                std::deque<std::function<void()>> tasks[lanes];
+            };
+
+            std::vector<std::unique_ptr<queue_t>> m_queues;
+            std::vector<std::thread> m_workers;
+            std::atomic<size_t> m_pending[lanes] = { };
+            std::atomic<size_t> m_next{ 0 };
+
+            std::mutex m_sleep;
+            std::condition_variable m_wake;
+            bool m_stop = false;
+
+            double m_dispatch = 0;
+
+            // Pool and queue of the calling worker thread
+            static inline thread_local thread_pool* t_pool = nullptr;
+            static inline thread_local size_t t_index = 0;
+
+            // Takes a task of the lanes up to X, the own deque first
+            _NODISCARD bool take(const size_t _index, const size_t _last_lane, std::function<void()>& _task, priority& _priority)
+            {
+                const size_t count = m_queues.size();
+
+                for (size_t lane = 0; lane <= _last_lane; ++lane)
+                {
+                    if (m_pending[lane].load(std::memory_order_acquire) == 0) {
+                        continue;
+                    }
+
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        auto& queue = *m_queues[(_index + i) % count];
+                        auto& tasks = queue.tasks[lane];
+
+                        std::lock_guard<std::mutex> guard(queue.lock);
+
+                        if (tasks.empty()) {
+                            continue;
+                        }
+
+                        if (i == 0) {
+                            _task = std::move(tasks.back());
+                            tasks.pop_back();
+                        }
+                        else {
+                            _task = std::move(tasks.front());
+                            tasks.pop_front();
+                        }
+
+                        m_pending[lane].fetch_sub(1, std::memory_order_relaxed);
+                        _priority = static_cast<priority>(lane);
+
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            _NODISCARD size_t pending() const noexcept
+            {
+                size_t count = 0;
+
+                for (const auto& lane : m_pending) {
+                    count += lane.load(std::memory_order_acquire);
+                }
+
+                return count;
+            }
+
+            static void execute(std::function<void()>& _task, const priority _priority)
+            {
+                priority_scope scope(_priority);
+                _task();
+            }
+
+            void work(const size_t _index)
+            {
+                t_pool = this;
+                t_index = _index;
+
+                bool pinned = false;
+
+                while (true)
+                {
+                    std::function<void()> task;
+                    priority lane;
+
+                    if (take(_index, lanes - 1, task, lane))
+                    {
+                        // Pinning can be turned on after the pool started
+                        if (!pinned) {
+                            pinned = pin_thread(_index);
+                        }
+
+                        execute(task, lane);
+                        continue;
+                    }
+
+                    std::unique_lock<std::mutex> lock(m_sleep);
+                    m_wake.wait(lock, [this]() { return m_stop || pending() != 0; });
+
+                    if (m_stop && pending() == 0) {
+                        return;
+                    }
+                }
+            }
+
+        public:
+            explicit thread_pool(const size_t _count)
+            {
+                for (size_t i = 0; i < _count; ++i) {
+                    m_queues.push_back(std::make_unique<queue_t>());
+                }
+
+                for (size_t i = 0; i < _count; ++i) {
+                    m_workers.emplace_back(&thread_pool::work, this, i);
+                }
+
+                // Round trip of an empty task, the cost model weighs handing work to a worker with it
+                std::array<double, 9> samples;
+
+                for (auto& sample : samples)
+                {
+                    auto task = std::make_shared<std::packaged_task<void()>>([]() { });
+                    auto done = task->get_future();
+
+                    const auto start = std::chrono::steady_clock::now();
+
+                    submit([task]() { (*task)(); }, priority::urgent);
+                    done.wait();
+
+                    sample = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+                }
+
+                std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+                m_dispatch = samples[samples.size() / 2];
+            }
+
+            thread_pool(const thread_pool&) = delete;
+            thread_pool& operator=(const thread_pool&) = delete;
+
+            // Runs the queued tasks and joins the workers
+            ~thread_pool()
+            {
+                {
+                    std::lock_guard<std::mutex> guard(m_sleep);
+                    m_stop = true;
+                }
+
+                m_wake.notify_all();
+
+                for (auto& worker : m_workers) {
+                    worker.join();
+                }
+            }
+
+            // Queues a task in the lane of the calling thread, workers queue on their own deque
+            void submit(std::function<void()> _task, const priority _priority = current_priority)
+            {
+                const size_t lane = static_cast<size_t>(_priority);
+                const size_t index = (t_pool == this) ? t_index : m_next.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+
+                {
+                    std::lock_guard<std::mutex> guard(m_queues[index]->lock);
+                    m_queues[index]->tasks[lane].push_back(std::move(_task));
+                }
+
+                m_pending[lane].fetch_add(1, std::memory_order_release);
+
+                // Taking the lock orders the notify after a worker checked pending() and started to wait
+                {
+                    std::lock_guard<std::mutex> guard(m_sleep);
+                }
+
+                m_wake.notify_one();
+            }
+
+            // Runs the waiting urgent tasks on the calling worker, long background tasks call this between their steps
+            void run_urgent()
+            {
+                std::function<void()> task;
+                priority lane;
+
+                while (take(t_index, 0, task, lane)) {
+                    execute(task, lane);
+                }
+            }
+
+            // Nanoseconds from submit() until a worker ran an empty task, measured when the pool started
+            _NODISCARD double dispatch() const noexcept
+            {
+                return m_dispatch;
+            }
+
+            // Pool of the calling thread if it is a worker, otherwise nullptr
+            _NODISCARD static thread_pool* current() noexcept
+            {
+                return t_pool;
+            }
+
+            _NODISCARD bool urgent_pending() const noexcept
+            {
+                return m_pending[0].load(std::memory_order_relaxed) != 0;
+            }
+
+            // The pool of the library, sized by get_thread_count() when it is first used
+            _NODISCARD static thread_pool& get()
+            {
+                static thread_pool pool(thread_settings::get().threads());
+                return pool;
+            }
+        };
+
+        // Lets a background task on a pool worker run the urgent tasks that are waiting (see thread_pool::run_urgent())
+        inline void yield_to_urgent()
+        {
+            thread_pool* pool = thread_pool::current();
+
+            if (pool != nullptr && pool->urgent_pending()) {
+                pool->run_urgent();
+            }
+        }
+
+        // Tasks 0 .. X - 1 of one operation, shared with the executor so tasks it starts late find nothing left to do
+        class task_group
+        {
+        private:
+            std::mutex m_lock;
+            std::condition_variable m_idle;
+            const size_t m_count;
+            size_t m_next = 0;
+            size_t m_running = 0;
+            bool m_closed = false;
+            std::exception_ptr m_error;
+            double m_latency = 0;
+
+        public:
+            explicit task_group(const size_t _count) : m_count(_count)
+            {
+
+            }
+
+            // Runs unclaimed tasks until there are none left
+            template <class Fn>
+            void work(Fn& _task)
+            {
+                while (true)
+                {
+                    size_t index;
+
+                    {
+                        std::lock_guard<std::mutex> guard(m_lock);
+
+                        if (m_closed || m_next == m_count) {
+                            return;
+                        }
+
+                        index = m_next++;
+                        ++m_running;
+                    }
+
+                    std::exception_ptr error;
+
+                    try {
+                        _task(index);
+                    }
+                    catch (...) {
+                        error = std::current_exception();
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> guard(m_lock);
+
+                        if (error && !m_error) {
+                            m_error = error;
+                        }
+
+                        --m_running;
+                    }
+
+                    m_idle.notify_all();
+                }
+            }
+
+            // Called by a task the executor started, keeps the time from submit() to the first one
+            void started(const std::chrono::steady_clock::time_point& _submitted)
+            {
+                const double latency = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - _submitted).count();
+
+                std::lock_guard<std::mutex> guard(m_lock);
+
+                if (!m_closed && m_latency == 0) {
+                    m_latency = latency;
+                }
+            }
+
+            // Nanoseconds until the executor started the first task, 0 if it started none before wait()
+            _NODISCARD double latency()
+            {
+                std::lock_guard<std::mutex> guard(m_lock);
+                return m_latency;
+            }
+
+            // Stops handing out tasks, waits for the running ones and rethrows the first exception
+            void wait()
+            {
+                std::unique_lock<std::mutex> lock(m_lock);
+
+                m_closed = true;
+                m_idle.wait(lock, [this]() { return m_running == 0; });
+
+                if (m_error) {
+                    std::rethrow_exception(m_error);
+                }
+            }
+        };
+
+        // Runs task(0) .. task(X - 1) through the executor and waits for them. The calling thread takes the tasks
+        // the executor has not started yet, so waiting inside a pool task or on a busy or inline executor can't deadlock.
+        // Returns the nanoseconds until the executor started its first task, 0 if it started none in time
+        template <class Fn>
+        double run_tasks(const executor& _executor, const size_t _count, Fn&& _task)
+        {
+            if (_count == 0) {
+                return 0;
+            }
+
+            auto group = std::make_shared<task_group>(_count);
+            const auto submitted = std::chrono::steady_clock::now();
+
+            for (size_t i = 1; i < _count; ++i) {
+                _executor([group, task = &_task, submitted]() { group->started(submitted); group->work(*task); });
+            }
+
+            group->work(_task);
+            group->wait();
+
+            return group->latency();
+        }
+
+        // Run fn() through the executor, the future holds its result or exception
+        template <class Fn>
+        _NODISCARD auto run_async(const executor& _executor, Fn&& _fn) -> std::future<decltype(_fn())>
+        {
+            auto task = std::make_shared<std::packaged_task<decltype(_fn())()>>(std::forward<Fn>(_fn));
+            auto future = task->get_future();
+
+            _executor([task]() { (*task)(); });
+
+            return future;
+        }
+
+        // Runs a task on the calling thread (see inline_executor()), parallel_chunks() skips the split for it
+        struct inline_runner
+        {
+            void operator()(std::function<void()> _task) const
+            {
+                _task();
+            }
+        };
+
+        // Runs a task on the library pool (see pool_executor()), the only executor the pool's dispatch cost is used for
+        struct pool_runner
+        {
+            void operator()(std::function<void()> _task) const
+            {
+                thread_pool::get().submit(std::move(_task));
+            }
+        };
+
+        // Kinds of work parallel_chunks() splits, the cost of one item is kept per kind and key size
+        enum class cost_op : uint32_t
+        {
+            public_block,
+            private_block,
+            encode,
+            verify
+        };
+
+        // Measured nanoseconds of one item per kind of work and key size, and of handing one task to a worker.
+        // parallel_chunks() runs work inline, on a few workers or on all of them depending on what pays off
+        class cost_model
+        {
+        private:
+            std::mutex m_lock;
+            std::unordered_map<uint64_t, double> m_items;
+            double m_dispatch = 0;
+            double m_foreign = 0;
+
+            // Hand off of a task to another thread until one through an executor of the application was timed
+            constexpr static inline double FOREIGN_DISPATCH = 50000;
+
+        public:
+            _NODISCARD static uint64_t key(const cost_op _op, const size_t _bytes) noexcept
+            {
+                return (static_cast<uint64_t>(_op) << 32) | static_cast<uint32_t>(_bytes);
+            }
+
+            // Cost of one item, 0 if this work was not measured yet
+            _NODISCARD double item(const uint64_t _key)
+            {
+                std::lock_guard<std::mutex> guard(m_lock);
+
+                const auto found = m_items.find(_key);
+                return (found != m_items.end()) ? found->second : 0;
+            }
+
+            // Adds a measurement, older ones fade out
+            void update(const uint64_t _key, const double _ns)
+            {
+                std::lock_guard<std::mutex> guard(m_lock);
+
+                auto& cost = m_items[_key];
+                cost = (cost == 0) ? _ns : cost * 0.75 + _ns * 0.25;
+            }
+
+            // Cost of handing a task to X: the profile value if one was loaded, the round trip the library pool measured
+            // when it started for pool_executor(), or what tasks of other executors took so far. The pool is only
+            // started for pool_executor(), an application with its own executor never gets the extra threads
+            _NODISCARD double dispatch(const executor& _executor)
+            {
+                {
+                    std::lock_guard<std::mutex> guard(m_lock);
+
+                    if (m_dispatch != 0) {
+                        return m_dispatch;
+                    }
+
+                    if (_executor.target<pool_runner>() == nullptr) {
+                        return (m_foreign != 0) ? m_foreign : FOREIGN_DISPATCH;
+                    }
+                }
+
+                return thread_pool::get().dispatch();
+            }
+
+            // Adds the time an executor other than pool_executor() took to start a task (see run_tasks())
+            void update_dispatch(const executor& _executor, const double _ns)
+            {
+                if (_ns <= 0 || _executor.target<pool_runner>() != nullptr) {
+                    return;
+                }
+
+                std::lock_guard<std::mutex> guard(m_lock);
+
+                m_foreign = (m_foreign == 0) ? _ns : m_foreign * 0.75 + _ns * 0.25;
+            }
+
+            // Workers for X nanoseconds of work on Y: T(w) = work / w + dispatch * w is the smallest at sqrt(work / dispatch)
+            _NODISCARD size_t workers(const executor& _executor, const double _work, const size_t _max)
+            {
+                const double best = std::sqrt(_work / std::max(dispatch(_executor), 1.0));
+
+                return static_cast<size_t>(std::clamp(best, 1.0, static_cast<double>(std::max<size_t>(_max, 1))));
+            }
+
+            // "dispatch <ns>" with the cost for X and one "<op> <key bytes> <ns>" line per measured work
+            void save(std::ostream& _out, const executor& _executor)
+            {
+                const double dispatch_ns = dispatch(_executor);
+
+                std::lock_guard<std::mutex> guard(m_lock);
+
+                _out << "dispatch " << dispatch_ns << "\n";
+
+                for (const auto& [key, ns] : m_items) {
+                    _out << (key >> 32) << " " << (key & 0xffffffff) << " " << ns << "\n";
+                }
+            }
+
+            _NODISCARD bool load(std::istream& _in)
+            {
+                std::string name;
+                double dispatch_ns = 0;
+
+                if (!(_in >> name >> dispatch_ns) || name != "dispatch" || dispatch_ns <= 0) {
+                    return false;
+                }
+
+                std::unordered_map<uint64_t, double> items;
+                uint64_t op = 0, bytes = 0;
+                double ns = 0;
+
+                while (_in >> op >> bytes >> ns) {
+                    if (ns > 0) {
+                        items[(op << 32) | (bytes & 0xffffffff)] = ns;
+                    }
+                }
+
+                if (!_in.eof()) {
+                    return false;
+                }
+
+                std::lock_guard<std::mutex> guard(m_lock);
+
+                m_dispatch = dispatch_ns;
+                m_items = std::move(items);
+
+                return true;
+            }
+
+            _NODISCARD static cost_model& get()
+            {
+                static cost_model model;
+                return model;
+            }
+        };
+
+        // Executor of the keys without their own (see set_default_executor())
+        struct executor_settings
+        {
+            std::mutex lock;
+            executor value;
+
+            _NODISCARD executor current()
+            {
+                std::lock_guard<std::mutex> guard(lock);
+
+                if (value) {
+                    return value;
+                }
+
+                return pool_runner{ };
+            }
+
+            _NODISCARD static executor_settings& get()
+            {
+                static executor_settings settings;
+                return settings;
+            }
+        };
+
+        // Pool of precomputed blinding pairs (r^e mod n, r^-1 mod n) for one key, refilled in the background
+        class blinding_pool
+        {
+        public:
+            using pair_t = std::pair<number_t, number_t>;
+
+        private:
+            // A queued refill either starts or is cancelled by the destructor, so a pool that goes away on the
+            // worker the refill waits for doesn`t wait for itself
+            enum class refill_state : uint8_t
+            {
+                queued,
+                running,
+                cancelled
+            };
+
+            const number_t m_n;
+            const uint32_t m_e;
+            const size_t m_size;
+
+            std::mutex m_lock;
+            std::vector<pair_t> m_pairs;
+            pair_t m_last;
+            bool m_refilling = false;
+            std::future<void> m_refill;
+            std::shared_ptr<std::atomic<refill_state>> m_refill_state;
+
+        public:
+            blinding_pool(const number_t& _n, const uint32_t _e, const size_t _size = 32) : m_n(_n), m_e(_e), m_size(std::max<size_t>(_size, 2))
+            {
+
+            }
+
+            ~blinding_pool()
+            {
+                if (m_refill.valid())
+                {
+                    auto expected = refill_state::queued;
+
+                    if (!m_refill_state->compare_exchange_strong(expected, refill_state::cancelled)) {
+                        m_refill.wait();
+                    }
+                }
+            }
+
+            // Take a pair, starts a refill on executor() in the background lane when the pool runs low
+            template <class Fn>
+            _NODISCARD pair_t take(const Fn& _executor)
+            {
+                std::unique_lock<std::mutex> lock(m_lock, std::defer_lock);
+
+                {
+                    RSA_TRACE_SCOPE("blinding_pool_wait");
+                    lock.lock();
+                }
+
+                if (m_pairs.empty() && m_last.first == 0)
+                {
+                    lock.unlock();
+                    auto fresh = generate(m_n, m_e, m_size);
+                    lock.lock();
+
+                    std::move(fresh.begin(), fresh.end(), std::back_inserter(m_pairs));
+                }
+
+                std::function<void()> refill;
+
+                if (m_pairs.empty())
+                {
+                    // Drained while the refill runs, squaring gives the valid pair for r^2
+                    m_last.first = (m_last.first * m_last.first) % m_n;
+                    m_last.second = (m_last.second * m_last.second) % m_n;
+
+                    refill = claim_refill();
+                }
+                else
+                {
+                    m_last = std::move(m_pairs.back());
+                    m_pairs.pop_back();
+
+                    if (m_pairs.size() < m_size / 2) {
+                        refill = claim_refill();
+                    }
+                }
+
+                const pair_t pair = m_last;
+
+                // An inline executor runs the refill right here, so it is submitted without the lock
+                lock.unlock();
+
+                if (refill) {
+                    submit_refill(_executor(), std::move(refill));
+                }
+
+                return pair;
+            }
+
+            // Generate X pairs with one modular inversion and 3X multiplications (Montgomery's trick)
+            _NODISCARD static std::vector<pair_t> generate(const number_t& _n, const uint32_t _e, const size_t _count)
+            {
+                RSA_TRACE_SCOPE("blinding_refill");
+
+                const size_t k = byte_length(_n);
+
+                std::vector<uint8_t> bytes(k + 8);
+                std::vector<number_t> r(_count), prefix(_count);
+
+                while (true)
+                {
+                    for (size_t i = 0; i < _count; ++i)
+                    {
+                        do {
+                            random_bytes(bytes.data(), bytes.size());
+                            r[i] = from_bytes(bytes.data(), bytes.size()) % _n;
+                        } while (r[i] < 2);
+
+                        prefix[i] = (i == 0) ? r[i] : (prefix[i - 1] * r[i]) % _n;
+                    }
+
+                    number_t inverse;
+
+                    // A product without inverse shares a factor with n, which is practically impossible, so just retry
+                    if (!inverse_mod(prefix.back(), _n, inverse)) {
+                        continue;
+                    }
+
+                    std::vector<pair_t> pairs(_count);
+
+                    // Walk back: r_i^-1 = (r_0 * ... * r_i)^-1 * (r_0 * ... * r_i-1)
+                    for (size_t i = _count; i-- > 0;)
+                    {
+                        pairs[i].second = (i == 0) ? inverse : (inverse * prefix[i - 1]) % _n;
+                        inverse = (inverse * r[i]) % _n;
+                        pairs[i].first = boost::multiprecision::powm(r[i], _e, _n);
+                    }
+
+                    return pairs;
+                }
+            }
+
+        private:
+            // Called with m_lock held, the refill task for submit_refill() or nothing if one is already queued
+            _NODISCARD std::function<void()> claim_refill()
+            {
+                if (m_refilling) {
+                    return { };
+                }
+
+                m_refilling = true;
+
+                auto task = std::make_shared<std::packaged_task<void()>>([this]()
+                {
+                    auto fresh = generate(m_n, m_e, m_size);
+
+                    std::lock_guard<std::mutex> guard(m_lock);
+                    std::move(fresh.begin(), fresh.end(), std::back_inserter(m_pairs));
+                    m_refilling = false;
+                });
+
+                auto state = std::make_shared<std::atomic<refill_state>>(refill_state::queued);
+
+                m_refill = task->get_future();
+                m_refill_state = state;
+
+                return [task, state]()
+                {
+                    auto expected = refill_state::queued;
+
+                    if (state->compare_exchange_strong(expected, refill_state::running)) {
+                        (*task)();
+                    }
+                };
+            }
+
+            void submit_refill(const executor& _executor, std::function<void()> _refill)
+            {
+                const priority_scope background(priority::background);
+
+                try {
+                    _executor(std::move(_refill));
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> guard(m_lock);
+                    m_refilling = false;
+                    throw;
+                }
+            }
+        };
+    }
+
+    // Worker threads per operation for key generation, encryption and decryption, 0 goes back to the detected
+    // count (RSA_THREADS, otherwise the allowed CPUs capped by the cgroup CPU quota).
+    // The pool of the async API keeps the size it was started with.
+    inline void set_thread_count(const uint32_t _count) noexcept
+    {
+        detail::thread_settings::get().count.store(_count, std::memory_order_relaxed);
+    }
+
+    _NODISCARD inline uint32_t get_thread_count() noexcept
+    {
+        return detail::thread_settings::get().threads();
+    }
+
+    // Pin the workers of the library pool to the allowed CPUs round robin, off by default or on with RSA_PIN_THREADS=1
+    inline void set_thread_pinning(const bool _pin) noexcept
+    {
+        detail::thread_settings::get().pinning.store(_pin, std::memory_order_relaxed);
+    }
+
+    // Runs every task on the calling thread
+    _NODISCARD inline executor inline_executor()
+    {
+        return detail::inline_runner{ };
+    }
+
+    // Runs the tasks on the pool of the library, the default
+    _NODISCARD inline executor pool_executor()
+    {
+        return detail::pool_runner{ };
+    }
+
+    // Executor of all keys without their own set_executor(), an empty one goes back to pool_executor()
+    inline void set_default_executor(executor _executor)
+    {
+        auto& settings = detail::executor_settings::get();
+
+        std::lock_guard<std::mutex> guard(settings.lock);
+        settings.value = std::move(_executor);
+    }
+
+    // Write the measured costs the choice between inline and parallel work is based on, e.g. to skip the
+    // measurements at the next start with load_cost_profile()
+    inline void save_cost_profile(std::ostream& _out)
+    {
+        detail::cost_model::get().save(_out, detail::executor_settings::get().current());
+    }
+
+    // Read costs written by save_cost_profile(), false if X is not a cost profile
+    inline bool load_cost_profile(std::istream& _in)
+    {
+        return detail::cost_model::get().load(_in);
+    }
+
+    // Key encodings for DER and PEM import / export
+    enum class key_format
+    {
+        pkcs1_private,  // RSAPrivateKey, PEM "RSA PRIVATE KEY"
+        pkcs8_private,  // PrivateKeyInfo, PEM "PRIVATE KEY"
+        pkcs1_public,   // RSAPublicKey, PEM "RSA PUBLIC KEY"
+        spki_public     // SubjectPublicKeyInfo, PEM "PUBLIC KEY"
+    };
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+    // Awaitable for the callback API, the coroutine resumes on the pool thread that finished the operation.
+    // An operation that finishes before await_suspend() returns, e.g. on inline_executor(), continues on the
+    // awaiting thread instead, so a loop of co_await doesn`t nest one resume per iteration on the stack
+    template <class T, class Start>
+    class awaitable
+    {
+    private:
+        Start m_start;
+        std::optional<T> m_result;
+        std::exception_ptr m_error;
+
+        // Set by whichever of await_suspend() and the callback gets there first, the second one continues
+        std::atomic<bool> m_handoff = false;
+
+    public:
+        explicit awaitable(Start _start) : m_start(std::move(_start))
+        {
+
+        }
+
+        _NODISCARD bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        // false if the operation already finished, then the coroutine isn`t suspended at all
+        _NODISCARD bool await_suspend(std::coroutine_handle<> _handle)
+        {
+            m_start([this, _handle](T _result, std::exception_ptr _error) mutable
+            {
+                if (_error) {
+                    m_error = _error;
+                }
+                else {
+                    m_result.emplace(std::move(_result));
+                }
+
+                if (m_handoff.exchange(true, std::memory_order_acq_rel)) {
+                    _handle.resume();
+                }
+            });
+
+            // Nothing of this object may be touched once the callback can resume the coroutine
+            return !m_handoff.exchange(true, std::memory_order_acq_rel);
+        }
+
+        T await_resume()
+        {
+            if (m_error) {
+                std::rethrow_exception(m_error);
+            }
+
+            return std::move(*m_result);
+        }
+    };
+#endif
+
+    // Non owning view of contiguous elements
+    template <class T>
+    class span
+    {
+    private:
+        T* m_data = nullptr;
+        size_t m_size = 0;
+
+    public:
+        constexpr span() noexcept = default;
+
+        constexpr span(T* _data, const size_t _size) noexcept : m_data(_data), m_size(_size)
+        {
+
+        }
+
+        template <class container_t, class = std::enable_if_t<std::is_convertible_v<std::remove_pointer_t<decltype(std::data(std::declval<container_t&>()))>(*)[], T(*)[]>>>
+        constexpr span(container_t& _container) noexcept : m_data(std::data(_container)), m_size(std::size(_container))
+        {
+
+        }
+
+        _NODISCARD constexpr T* data() const noexcept
+        {
+            return m_data;
+        }
+
+        _NODISCARD constexpr size_t size() const noexcept
+        {
+            return m_size;
+        }
+
+        _NODISCARD constexpr bool empty() const noexcept
+        {
+            return m_size == 0;
+        }
+
+        _NODISCARD constexpr T* begin() const noexcept
+        {
+            return m_data;
+        }
+
+        _NODISCARD constexpr T* end() const noexcept
+        {
+            return m_data + m_size;
+        }
+
+        _NODISCARD constexpr T& operator[](const size_t _index) const noexcept
+        {
+            return m_data[_index];
+        }
+
+        _NODISCARD constexpr span subspan(const size_t _offset, const size_t _count) const noexcept
+        {
+            return span(m_data + _offset, _count);
+        }
+    };
+
+    // Hybrid ciphertext: RSA-KEM encapsulated key, ChaCha20 encrypted payload and Poly1305 tag
+    struct hybrid_t
+    {
+        number_t key;
+        std::vector<uint8_t> payload;
+        std::array<uint8_t, 16> tag{ };
+    };
+
+    // Results of many messages in one buffer, item i is data[offsets[i], offsets[i + 1])
+    template <class T>
+    struct batch_t
+    {
+        std::vector<T> data;
+        std::vector<size_t> offsets{ 0 };
+
+        _NODISCARD size_t size() const noexcept
+        {
+            return offsets.size() - 1;
+        }
+
+        _NODISCARD span<const T> operator[](const size_t _index) const noexcept
+        {
+            return span<const T>(data.data() + offsets[_index], offsets[_index + 1] - offsets[_index]);
+        }
+    };
+
+    // One limb of a packed_t block
+    using limb_t = boost::multiprecision::limb_type;
+
+    // Read only view of one block of a packed_t, the limbs are aliased and not copied
+    class block_view
+    {
+    private:
+        const limb_t* m_limbs = nullptr;
+        size_t m_size = 0;
+
+    public:
+        block_view(const limb_t* _limbs, const size_t _size) noexcept : m_limbs(_limbs), m_size(_size)
+        {
+
+        }
+
+        // The limbs, least significant first
+        _NODISCARD span<const limb_t> limbs() const noexcept
+        {
+            return span<const limb_t>(m_limbs, m_size);
+        }
+
+        // Reads the block into X, reuses the limbs X already has
+        void load(number_t& _out) const
+        {
+            boost::multiprecision::import_bits(_out, m_limbs, m_limbs + m_size, std::numeric_limits<limb_t>::digits, false);
+        }
+
+        // Copy of the block
+        _NODISCARD number_t value() const
+        {
+            number_t result;
+            load(result);
+            return result;
+        }
+    };
+
+    // Ciphertext blocks as fixed stride limb arrays in one buffer, one allocation per message instead of one per block.
+    // Block i is data()[i * stride(), (i + 1) * stride()), least significant limb first and padded with zeros
+    class packed_t
+    {
+    private:
+        std::vector<limb_t> m_limbs;
+        size_t m_stride = 0;
+
+    public:
+        packed_t() = default;
+
+        // X zero blocks of Y limbs
+        packed_t(const size_t _count, const size_t _stride) : m_limbs(_count * _stride), m_stride(_stride)
+        {
+
+        }
+
+        // Packs the blocks of basic_rsa::encrypt(), the stride is the one of the largest block
+        explicit packed_t(const std::vector<number_t>& _blocks)
+        {
+            for (const auto& block : _blocks) {
+                m_stride = std::max(m_stride, stride_for(block));
+            }
+
+            m_limbs.resize(_blocks.size() * m_stride);
+
+            for (size_t i = 0; i < _blocks.size(); ++i) {
+                set(i, _blocks[i]);
+            }
+        }
+
+        // Limbs for numbers up to X, stride_for(n) fits every block of the key with the modulus n
+        _NODISCARD static size_t stride_for(const number_t& _num) noexcept
+        {
+            return std::max<size_t>((detail::byte_length(_num) + sizeof(limb_t) - 1) / sizeof(limb_t), 1);
+        }
+
+        _NODISCARD size_t size() const noexcept
+        {
+            return (m_stride == 0) ? 0 : m_limbs.size() / m_stride;
+        }
+
+        _NODISCARD size_t stride() const noexcept
+        {
+            return m_stride;
+        }
+
+        _NODISCARD bool empty() const noexcept
+        {
+            return m_limbs.empty();
+        }
+
+        _NODISCARD const limb_t* data() const noexcept
+        {
+            return m_limbs.data();
+        }
+
+        // View of block X
+        _NODISCARD block_view operator[](const size_t _index) const noexcept
+        {
+            return block_view(m_limbs.data() + _index * m_stride, m_stride);
+        }
+
+        // Writes Y into block X, false if Y is negative or doesn`t fit into the stride
+        bool set(const size_t _index, const number_t& _num) noexcept
+        {
+            if (_num < 0 || stride_for(_num) > m_stride) {
+                return false;
+            }
+
+            limb_t* block = m_limbs.data() + _index * m_stride;
+
+            std::fill(block, block + m_stride, limb_t(0));
+            boost::multiprecision::export_bits(_num, block, std::numeric_limits<limb_t>::digits, false);
+
+            return true;
+        }
+
+        // The blocks as separate numbers again
+        _NODISCARD std::vector<number_t> unpack() const
+        {
+            std::vector<number_t> blocks(size());
+
+            for (size_t i = 0; i < blocks.size(); ++i) {
+                blocks[i] = (*this)[i].value();
+            }
+
+            return blocks;
+        }
+    };
+
+    template<class _char, bool _throw>
+    void print(basic_rsa<_char, _throw> _rsa) {
+        std::cout << _rsa;
+    }
+
+    template <class char_type = char, bool throw_errors = false> 
+    class basic_rsa
+    {
+    private:
+        
+        constexpr static inline auto one_in_block_size = std::numeric_limits<char_type>::digits10 + 2;
+        constexpr static inline auto char_size = sizeof(char_type);
+
+        typedef std::tuple<number_t, number_t, number_t, number_t, uint32_t, uint32_t> export_t;
+        using string = std::basic_string<char_type>;
+        using string_view = std::basic_string_view<char_type>;
+
+    protected:
+        constexpr static inline uint32_t DEFAULT_BITS = static_cast<uint32_t>(3072);
+        constexpr static inline uint32_t DEFAULT_TRYS = static_cast<uint32_t>(-1);
+        constexpr static inline uint32_t MIN_BLOCKSIZE = static_cast<uint32_t>(one_in_block_size);
+
+        // DER DigestInfo prefix of a SHA-256 hash for EMSA-PKCS1-v1_5
+        constexpr static inline uint8_t SHA256_DIGEST_INFO[19] = {
+            0x30, 0x31, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01, 0x05, 0x00, 0x04, 0x20
+        };
+
+        // Binary key: "RSAK", version and limb bits, bits, e, flags, reserved, then every number as limb count and
+        // little endian 64 bit limbs (p, q, n, d, dp, dq, qinv, or only n for a public key) and a FNV-1a checksum
+        constexpr static inline char BINARY_MAGIC[4] = { 'R', 'S', 'A', 'K' };
+        constexpr static inline uint32_t BINARY_VERSION = 1;
+        constexpr static inline uint32_t BINARY_PRIVATE = 1;
+        constexpr static inline size_t BINARY_HEADER = 24;
+
+    private:
+        bool m_setupdone = false;
+        uint32_t m_bits = DEFAULT_BITS;
+        uint32_t m_trys = DEFAULT_TRYS;
+        bool m_blinding = true;
+
+        // UTF-8 for wide strings in the byte oriented modes (see set_utf8())
+        bool m_utf8 = false;
+
+        // LZ compression before encrypt() (see set_compression())
+        bool m_compress = false;
+
+        // Empty for the default executor
+        executor m_executor;
+        std::shared_ptr<detail::blinding_pool> m_blinding_pool;
+        std::shared_ptr<detail::lazy_private> m_lazy;
+
+    public:
+        uint32_t e = 0;
+        number_t p, q, n, d;
+
+        // CRT parameters: d mod (p - 1), d mod (q - 1) and q^-1 mod p
+        number_t dp, dq, qinv;
+
+        std::tuple<uint32_t&, number_t&> public_key { e, n };
+        std::tuple<number_t&, number_t&> private_key{ d, n };
+
+        friend class basic_public_key<char_type, throw_errors>;
+        friend class keystore;
+
+    public:
+        constexpr basic_rsa() :m_bits(3072), m_trys(17) {
+
+        }
+
+        constexpr basic_rsa(const uint32_t _bits, const uint32_t _trys = DEFAULT_TRYS) {
+            set(_bits, _trys);
+        }
+
+        // public_key and private_key refer to the members of this object, so copies must not take them over
+        basic_rsa(const basic_rsa& _other) {
+            *this = _other;
+        }
+
+        basic_rsa(basic_rsa&& _other) noexcept {
+            *this = std::move(_other);
+        }
+
+        basic_rsa& operator=(const basic_rsa& _other)
+        {
+            if (this != &_other)
+            {
+                m_setupdone = _other.m_setupdone;
+                m_bits = _other.m_bits;
+                m_trys = _other.m_trys;
+                m_blinding = _other.m_blinding;
+                m_utf8 = _other.m_utf8;
+                m_compress = _other.m_compress;
+                m_executor = _other.m_executor;
+                m_blinding_pool = _other.m_blinding_pool;
+                m_lazy = _other.m_lazy;
+                e = _other.e;
+                p = _other.p; q = _other.q; n = _other.n; d = _other.d;
+                dp = _other.dp; dq = _other.dq; qinv = _other.qinv;
+            }
+            return *this;
+        }
+
+        basic_rsa& operator=(basic_rsa&& _other) noexcept
+        {
+            if (this != &_other)
+            {
+                m_setupdone = _other.m_setupdone;
+                m_bits = _other.m_bits;
+                m_trys = _other.m_trys;
+                m_blinding = _other.m_blinding;
+                m_utf8 = _other.m_utf8;
+                m_compress = _other.m_compress;
+                m_executor = std::move(_other.m_executor);
+                m_blinding_pool = std::move(_other.m_blinding_pool);
+                m_lazy = std::move(_other.m_lazy);
+                e = _other.e;
+                p = std::move(_other.p); q = std::move(_other.q); n = std::move(_other.n); d = std::move(_other.d);
+                dp = std::move(_other.dp); dq = std::move(_other.dq); qinv = std::move(_other.qinv);
+            }
+            return *this;
+        }
+
+        // Import values from exported RSA file
+        constexpr basic_rsa(const std::string_view& _file) {
+            import_file(_file);
+        }
+
+        // Import values from exported RSA file
+        constexpr basic_rsa(std::ifstream& _file) {
+            import_file(_file);
+        }
+
+        // Import values from other RSA class
+        constexpr basic_rsa(const export_t& _key) {
+            import_key(_key);
+        }
+
+        // Check if setup() is already done
+        _NODISCARD constexpr operator bool() const noexcept
+        {
+            return m_setupdone;
+        }
+
+        // Check if setup() is already done
+        _NODISCARD constexpr bool setupdone() const noexcept
+        {
+            return m_setupdone;
+        }
+
+        // The bits of the generated primes
+        _NODISCARD constexpr uint32_t keysize() const noexcept
+        {
+            return m_bits;
+        }
+
+        // The current amouth of Miller Rabin tests
+        _NODISCARD constexpr uint32_t trys() const noexcept
+        {
+            return m_trys;
+        }
+
+        // How likely the numbers generated are prime in percent
+        _NODISCARD constexpr double_t precision() const noexcept
+        {
+            return 100.0 - (std::pow(2, static_cast<int64_t>(m_trys) * -1) * 100.0);
+        }
+        
+        // Set new keysize, blocksize and trys
+        constexpr void set(uint32_t _bits = DEFAULT_BITS, uint32_t _trys = DEFAULT_TRYS) noexcept(!throw_errors)
+        {
+            if (_bits == 0) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("key size can`t be 0");
+                }
+
+                _bits = DEFAULT_BITS;
+            }
+
+            if (_trys == 0) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("can`t have 0 trys");
+                }
+
+                _trys = DEFAULT_TRYS;
+            }
+
+            if (_bits % 8 != 0) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("keysize has to be dividable by 8");
+                }
+
+                _bits = (8 - _bits % 8);
+            }
+
+            m_bits = _bits;
+
+            if (_trys == DEFAULT_TRYS) {
+                m_trys = get_rabin_trys(_bits);
+            }
+            else {
+                m_trys = _trys;
+            }
+        }
+
+        // Turn blinding of private key operations on or off
+        constexpr void set_blinding(const bool _blinding) noexcept
+        {
+            m_blinding = _blinding;
+        }
+
+        // Convert wide strings to UTF-8 for encrypt_oaep() and encrypt_hybrid() and back when they are decrypted,
+        // mostly ASCII text then needs 2 - 4 times fewer bytes. Both sides need the same setting. encrypt() writes
+        // every code unit as its decimal digits, which is as short for ASCII in wide strings as in char ones
+        constexpr void set_utf8(const bool _utf8) noexcept
+        {
+            m_utf8 = _utf8;
+        }
+
+        // Compress messages with the bundled LZ codec before encrypt() and decompress them in decrypt(), a flag in
+        // front of every message tells if it was compressed, so text that doesn`t get shorter is sent as it is.
+        // Both sides need the same setting, encrypt_batch() is not compressed
+        constexpr void set_compression(const bool _compress) noexcept
+        {
+            m_compress = _compress;
+        }
+
+        // Run the block and prime search tasks of this key on X, e.g. inline_executor() or the pool of the application
+        void set_executor(executor _executor)
+        {
+            m_executor = std::move(_executor);
+        }
+
+        _NODISCARD executor get_executor() const
+        {
+            return m_executor ? m_executor : detail::executor_settings::get().current();
+        }
+
+        // Check if private key operations are blinded
+        _NODISCARD constexpr bool blinding() const noexcept
+        {
+            return m_blinding;
+        }
+
+        // Set the size of the key
+        constexpr void set_keysize(const uint32_t _bits)
+        {
+            set(_bits, m_trys);
+        }
+
+        // Set how many Miller Rabin tests to perform
+        constexpr void set_trys(const uint32_t _trys)
+        {
+            set(m_bits, _trys);
+        }
+
+        // Import file from a filepath
+        bool import_file(const std::string_view& _filename)
+        {
+            std::ifstream _file(_filename.data());
+            return import_file(_file);
+        }
+
+        // Import file from an ifstream
+        bool import_file(std::ifstream& _file)
+        {
+            RSA_METRIC_SCOPE(import);
+
+            if (_file.good() == false) {
+                return false;
+            }
+
+            std::string _line;
+
+            do
+            {
+                if (!std::getline(_file, _line)) {
+                    _file.close();
+                    return false;
+                }
+            } while (_line != "-----BEGIN EXPORT-----");
+
+            if (std::getline(_file, _line))
+                p.assign(_line);
+
+            if (std::getline(_file, _line))
+                q.assign(_line);
+
+            if (std::getline(_file, _line))
+                n.assign(_line);
+
+            if (std::getline(_file, _line))
+                d.assign(_line);
+
+            if (std::getline(_file, _line))
+                e = detail::dton<uint32_t>(_line.c_str());
+
+            if (std::getline(_file, _line))
+                m_bits = detail::dton<uint32_t>(_line.c_str());
+
+            _file.close();
+            
+            set(m_bits);
+
+            compute_crt();
+
+            m_setupdone = true;
+
+            return true;
+        }
+
+        // Export current setup as a binary key
+        _NODISCARD std::vector<uint8_t> export_binary() const
+        {
+            RSA_METRIC_SCOPE(export_);
+
+            check_setup();
+
+            std::vector<uint8_t> data(BINARY_HEADER, 0);
+
+            std::memcpy(data.data(), BINARY_MAGIC, sizeof(BINARY_MAGIC));
+            detail::store_le32(data.data() + 4, BINARY_VERSION | (64 << 16));
+            detail::store_le32(data.data() + 8, m_bits);
+            detail::store_le32(data.data() + 12, e);
+
+            if (has_private_key())
+            {
+                const auto key = private_parts();
+
+                detail::store_le32(data.data() + 16, BINARY_PRIVATE);
+
+                for (const number_t* num : { &key.p, &key.q, &n, &key.d, &key.dp, &key.dq, &key.qinv }) {
+                    detail::write_limbs(data, *num);
+                }
+            }
+            else {
+                detail::write_limbs(data, n);
+            }
+
+            const uint64_t checksum = detail::fnv1a64(data.data(), data.size());
+
+            data.resize(data.size() + 8);
+            detail::store_le64(data.data() + data.size() - 8, checksum);
+
+            return data;
+        }
+
+        // Export current setup to a binary key file
+        bool export_binary(const std::string_view& _filename) const
+        {
+            const auto data = export_binary();
+
+            std::ofstream _file(std::string(_filename), std::ios::binary);
+
+            if (_file.good() == false) {
+                return false;
+            }
+
+            _file.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+            return _file.good();
+        }
+
+        // Import a binary key file, the file is memory mapped and the numbers are read straight from the mapped limbs
+        bool import_binary(const std::string_view& _filename)
+        {
+            const detail::mapped_file _file(_filename);
+
+            return _file && import_binary(_file.data(), _file.size());
+        }
+
+        // Import a binary key from memory
+        bool import_binary(const uint8_t* _data, const size_t _size)
+        {
+            RSA_METRIC_SCOPE(import);
+
+            if (!check_binary(_data, _size)) {
+                return false;
+            }
+
+            const uint32_t flags = detail::load_le32(_data + 16);
+            const uint8_t* end = _data + _size - 8;
+            const uint8_t* ptr = _data + BINARY_HEADER;
+            number_t values[7];
+
+            // Public keys only store n
+            for (number_t& value : values) {
+                if (!detail::read_limbs(ptr, end, (flags & BINARY_PRIVATE) ? value : values[2])) {
+                    return false;
+                }
+
+                if ((flags & BINARY_PRIVATE) == 0) {
+                    break;
+                }
+            }
+
+            if (ptr != end) {
+                return false;
+            }
+
+            p = std::move(values[0]);
+            q = std::move(values[1]);
+            n = std::move(values[2]);
+            d = std::move(values[3]);
+            dp = std::move(values[4]);
+            dq = std::move(values[5]);
+            qinv = std::move(values[6]);
+
+            e = detail::load_le32(_data + 12);
+            m_bits = detail::load_le32(_data + 8);
+
+            set(m_bits);
+
+            reset_key_state(flags & BINARY_PRIVATE);
+
+            m_setupdone = true;
+
+            return true;
+        }
+
+        // Export the key as DER (PKCS#1 RSAPrivateKey / RSAPublicKey, PKCS#8 PrivateKeyInfo or SubjectPublicKeyInfo)
+        _NODISCARD std::vector<uint8_t> export_der(const key_format _format = key_format::pkcs1_private) const
+        {
+            RSA_METRIC_SCOPE(export_);
+
+            using der = detail::der_reader;
+
+            const bool is_private = (_format == key_format::pkcs1_private || _format == key_format::pkcs8_private);
+
+            if (is_private) {
+                check_private();
+            }
+            else {
+                check_setup();
+            }
+
+            detail::der_writer fields;
+
+            if (is_private) {
+                const auto key = private_parts();
+
+                fields.integer(0).integer(n).integer(e).integer(key.d).integer(key.p).integer(key.q).integer(key.dp).integer(key.dq).integer(key.qinv);
+            }
+            else {
+                fields.integer(n).integer(e);
+            }
+
+            detail::der_writer key;
+            key.element(der::SEQUENCE, fields);
+
+            if (_format == key_format::pkcs1_private || _format == key_format::pkcs1_public) {
+                return key.data();
+            }
+
+            detail::der_writer info;
+
+            if (_format == key_format::pkcs8_private) {
+                info.integer(0).raw(detail::RSA_ALGORITHM_ID, sizeof(detail::RSA_ALGORITHM_ID)).element(der::OCTET_STRING, key);
+            }
+            else
+            {
+                // BIT STRING content starts with the number of unused bits
+                std::vector<uint8_t> bits(1, 0);
+                bits.insert(bits.end(), key.data().begin(), key.data().end());
+
+                info.raw(detail::RSA_ALGORITHM_ID, sizeof(detail::RSA_ALGORITHM_ID)).element(der::BIT_STRING, bits.data(), bits.size());
+            }
+
+            detail::der_writer result;
+            result.element(der::SEQUENCE, info);
+
+            return result.data();
+        }
+
+        // Export the key as PEM
+        _NODISCARD std::string export_pem(const key_format _format = key_format::pkcs1_private) const
+        {
+            const auto der = export_der(_format);
+            const std::string_view label = pem_label(_format);
+
+            std::string pem;
+
+            pem.append("-----BEGIN ").append(label).append("-----\n");
+            pem.append(detail::base64_encode(der.data(), der.size()));
+            pem.append("\n-----END ").append(label).append("-----\n");
+
+            return pem;
+        }
+
+        // Import a DER key, the format is detected and the numbers are read in place from the buffer
+        bool import_der(const uint8_t* _data, const size_t _size)
+        {
+            RSA_METRIC_SCOPE(import);
+
+            using der = detail::der_reader;
+
+            der input(_data, _size), body;
+
+            if (!input.read(der::SEQUENCE, body) || !input.empty()) {
+                return false;
+            }
+
+            // SubjectPublicKeyInfo: SEQUENCE { AlgorithmIdentifier, BIT STRING { RSAPublicKey } }
+            if (body.peek() == der::SEQUENCE)
+            {
+                der algorithm, bits;
+
+                if (!body.read(der::SEQUENCE, algorithm) || !is_rsa_algorithm(algorithm) || !body.read(der::BIT_STRING, bits) || bits.size() < 2 || *bits.data() != 0) {
+                    return false;
+                }
+
+                return import_pkcs1(bits.data() + 1, bits.size() - 1);
+            }
+
+            // PrivateKeyInfo: SEQUENCE { INTEGER 0, AlgorithmIdentifier, OCTET STRING { RSAPrivateKey } }
+            der probe = body;
+            uint32_t version;
+
+            if (probe.integer(version) && probe.peek() == der::SEQUENCE)
+            {
+                der algorithm, key;
+
+                if (version != 0 || !probe.read(der::SEQUENCE, algorithm) || !is_rsa_algorithm(algorithm) || !probe.read(der::OCTET_STRING, key)) {
+                    return false;
+                }
+
+                return import_pkcs1(key.data(), key.size());
+            }
+
+            return import_pkcs1(_data, _size);
+        }
+
+        // Import a PEM key
+        bool import_pem(const std::string_view& _pem)
+        {
+            const size_t begin = _pem.find("-----BEGIN ");
+
+            if (begin == std::string_view::npos) {
+                return false;
+            }
+
+            const size_t body = _pem.find("-----", begin + 11);
+            const size_t end = (body == std::string_view::npos) ? body : _pem.find("-----END ", body + 5);
+
+            if (end == std::string_view::npos) {
+                return false;
+            }
+
+            std::vector<uint8_t> der;
+
+            if (!detail::base64_decode(_pem.substr(body + 5, end - body - 5), der)) {
+                return false;
+            }
+
+            return import_der(der.data(), der.size());
+        }
+
+        // Import a PEM or DER key file
+        bool import_key_file(const std::string_view& _filename)
+        {
+            const detail::mapped_file _file(_filename);
+
+            if (!_file) {
+                return false;
+            }
+
+            if (_file.data()[0] == detail::der_reader::SEQUENCE) {
+                return import_der(_file.data(), _file.size());
+            }
+
+            return import_pem(std::string_view(reinterpret_cast<const char*>(_file.data()), _file.size()));
+        }
+
+        // Check if the private key is available (false after importing a public key)
+        _NODISCARD bool has_private_key() const noexcept
+        {
+            return m_setupdone && (m_lazy != nullptr || d != 0);
+        }
+
+        // Import setup from other RSA class export
+        void import_key(const export_t& _key)
+        {
+            RSA_METRIC_SCOPE(import);
+
+            p = std::get<0>(_key);
+            q = std::get<1>(_key);
+            n = std::get<2>(_key);
+            d = std::get<3>(_key);
+            e = std::get<4>(_key);
+            m_bits = std::get<5>(_key);
+
+            set(m_bits);
+
+            compute_crt();
+
+            m_setupdone = true;
+        }
+
+        // Export current setup to a filepath
+        bool export_file(const std::string_view& _filename)
+        {
+            std::ofstream _file(_filename.data());
+            return export_file(_file);
+        }
+
+        // Export current setup to an ostream
+        bool export_file(std::ofstream& _file)
+        {
+            RSA_METRIC_SCOPE(export_);
+
+            if (m_setupdone == false) {
+                throw std::exception("You have to call setup() before you try to export a key.");
+            }
+
+            check_private();
+
+            if (_file.good() == false) {
+                return false;
+            }
+
+            _file << "-----BEGIN EXPORT-----\n";
+
+            const auto key = private_parts();
+
+            _file << key.p.str() << '\n';
+            _file << key.q.str() << '\n';
+            _file << n.str() << '\n';
+            _file << key.d.str() << '\n';
+            _file << std::to_string(e) << '\n';
+            _file << std::to_string(m_bits) << '\n';
+
+            _file << "-----END EXPORT-----\n";
+
+            _file.close();
+
+            return true;
+        }
+
+        // Export current setup
+        _NODISCARD const export_t export_key()
+        {
+            RSA_METRIC_SCOPE(export_);
+
+            const auto key = private_parts();
+
+            return { key.p, key.q, n, key.d, e, m_bits };
+        }
+
+        // Generate the primes
+        void setup() noexcept
+        {
+            RSA_METRIC_SCOPE(setup);
+            RSA_TRACE_SCOPE("setup");
+
+            m_setupdone = false;
+
+            while (true)
+            {
+                const auto pair = generate_prime_pair(m_bits, m_trys, get_executor());
+
+                RSA_TRACE_SCOPE("derive_key");
+
+                p = pair.first;
+                q = pair.second;
+
+                n = p * q;
+
+                const number_t phi = (p - 1) * (q - 1);
+
+                e = 65537;
+
+                if (boost::multiprecision::gcd(e, phi) != 1) {
+                    e = 2;
+                    while (boost::multiprecision::gcd(e, phi) != 1) {
+                        ++e;
+                    }
+                }
+                
+                d = inverse_mod(e, phi);
+
+                if ((e * d) % phi == 1) {
+                    break;
+                }
+            }
+
+            compute_crt();
+
+            m_setupdone = true;
+        }
+
+        // Encrypts a string
+        _NODISCARD std::vector<number_t> encrypt(const string_view& _str, const std::tuple<uint32_t&, number_t&>& _public_key) const
+        {
+            check_setup();
+
+            return encrypt_with(_str, std::get<0>(_public_key), std::get<1>(_public_key), m_bits, m_compress, get_executor());
+        }
+
+        // Encrypts many short messages at once, the blocks of all messages are split across the threads together
+        // and message i gets the blocks result[i], empty messages get no blocks
+        _NODISCARD batch_t<number_t> encrypt_batch(const span<const string_view>& _messages, const std::tuple<uint32_t&, number_t&>& _public_key) const
+        {
+            check_setup();
+
+            return encrypt_batch_with(_messages, std::get<0>(_public_key), std::get<1>(_public_key), m_bits, get_executor());
+        }
+
+        // Encrypts a string into one packed_t buffer instead of a number per block, see decrypt(const packed_t&)
+        _NODISCARD packed_t encrypt_packed(const string_view& _str, const std::tuple<uint32_t&, number_t&>& _public_key) const
+        {
+            check_setup();
+
+            return encrypt_packed_with(_str, std::get<0>(_public_key), std::get<1>(_public_key), m_bits, m_compress, get_executor());
+        }
+
+        // Decrypts the encrypted blocks, the blocks are only read
+        _NODISCARD string decrypt(const std::vector<number_t>& _encrypted) const
+        {
+            return decrypt(span<const number_t>(_encrypted.data(), _encrypted.size()));
+        }
+
+        // Decrypts the encrypted blocks without copying or changing them, every thread works in its own scratch numbers
+        _NODISCARD string decrypt(const span<const number_t>& _encrypted) const
+        {
+            RSA_METRIC_SCOPE(decrypt);
+            RSA_TRACE_SCOPE("decrypt");
+
+            check_private();
+
+            std::vector<string> parts(_encrypted.size());
+            std::atomic<bool> valid = true;
+
+            parallel_chunks(get_executor(), parts.size(), detail::cost_model::key(detail::cost_op::private_block, detail::byte_length(n)), [this, &_encrypted, &parts, &valid](const size_t _begin, const size_t _end)
+            {
+                auto& tmp = scratch();
+
+                for (size_t i = _begin; i < _end; ++i)
+                {
+                    if (_encrypted[i] < 0 || _encrypted[i] >= n) {
+                        valid = false;
+                        continue;
+                    }
+
+                    private_op(_encrypted[i], tmp.plain);
+                    parts[i] = decode_block(tmp.plain.template convert_to<std::string>());
+                }
+            });
+
+            if (!valid) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Invalid ciphertext blocks");
+                }
+                return { };
+            }
+
+            string decrypted; decrypted.reserve(_encrypted.size() * char_size);
+
+            for (const auto& part : parts) {
+                decrypted.append(part);
+            }
+
+            if (!unpack_text(decrypted)) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Invalid compressed message");
+                }
+                return { };
+            }
+
+            return decrypted;
+        }
+
+        // Decrypts a packed_t, every block is read into the scratch numbers of the thread
+        _NODISCARD string decrypt(const packed_t& _encrypted) const
+        {
+            RSA_METRIC_SCOPE(decrypt);
+            RSA_TRACE_SCOPE("decrypt");
+
+            check_private();
+
+            std::vector<string> parts(_encrypted.size());
+            std::atomic<bool> valid = true;
+
+            parallel_chunks(get_executor(), parts.size(), detail::cost_model::key(detail::cost_op::private_block, detail::byte_length(n)), [this, &_encrypted, &parts, &valid](const size_t _begin, const size_t _end)
+            {
+                auto& tmp = scratch();
+
+                for (size_t i = _begin; i < _end; ++i)
+                {
+                    _encrypted[i].load(tmp.block);
+
+                    if (tmp.block >= n) {
+                        valid = false;
+                        continue;
+                    }
+
+                    private_op(tmp.block, tmp.plain);
+                    parts[i] = decode_block(tmp.plain.template convert_to<std::string>());
+                }
+            });
+
+            if (!valid) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Invalid ciphertext blocks");
+                }
+                return { };
+            }
+
+            string decrypted;
+
+            for (const auto& part : parts) {
+                decrypted.append(part);
+            }
+
+            if (!unpack_text(decrypted)) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Invalid compressed message");
+                }
+                return { };
+            }
+
+            return decrypted;
+        }
+
+        // Decrypts fixed width big endian blocks without copying them first, e.g. ciphertext_file::blocks()
+        _NODISCARD string decrypt(const span<const uint8_t>& _blocks) const
+        {
+            RSA_METRIC_SCOPE(decrypt);
+            RSA_TRACE_SCOPE("decrypt");
+
+            check_private();
+
+            const size_t k = detail::byte_length(n);
+
+            if (_blocks.empty() || _blocks.size() % k != 0) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Invalid ciphertext blocks");
+                }
+                return { };
+            }
+
+            const size_t count = _blocks.size() / k;
+
+            std::vector<string> decrypted(count);
+            std::atomic<bool> valid = true;
+
+            parallel_chunks(get_executor(), count, detail::cost_model::key(detail::cost_op::private_block, k), [this, &_blocks, &decrypted, &valid, k](const size_t _begin, const size_t _end)
+            {
+                auto& tmp = scratch();
+
+                for (size_t i = _begin; i < _end; ++i)
+                {
+                    detail::from_bytes(_blocks.data() + i * k, k, tmp.block);
+
+                    if (tmp.block >= n) {
+                        valid = false;
+                        continue;
+                    }
+
+                    private_op(tmp.block, tmp.plain);
+
+                    decrypted[i] = decode_block(tmp.plain.template convert_to<std::string>());
+                }
+            });
+
+            if (!valid) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Invalid ciphertext blocks");
+                }
+                return { };
+            }
+
+            string result; result.reserve(count * k);
+
+            for (const auto& block : decrypted) {
+                result.append(block);
+            }
+
+            if (!unpack_text(result)) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Invalid compressed message");
+                }
+                return { };
+            }
+
+            return result;
+        }
+
+        // Decrypts the result of encrypt_batch(), message i is result[i]
+        _NODISCARD batch_t<char_type> decrypt_batch(const batch_t<number_t>& _encrypted) const
+        {
+            RSA_METRIC_SCOPE(decrypt);
+            RSA_TRACE_SCOPE("decrypt_batch");
+
+            check_private();
+
+            const auto& offsets = _encrypted.offsets;
+
+            if (offsets.empty() || offsets.front() != 0 || offsets.back() != _encrypted.data.size() || !std::is_sorted(offsets.begin(), offsets.end())) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Invalid batch offsets");
+                }
+                return { };
+            }
+
+            std::vector<string> decrypted(_encrypted.data.size());
+
+            parallel_chunks(get_executor(), decrypted.size(), detail::cost_model::key(detail::cost_op::private_block, detail::byte_length(n)), [this, &_encrypted, &decrypted](const size_t _begin, const size_t _end)
+            {
+                auto& tmp = scratch();
+
+                for (size_t i = _begin; i < _end; ++i)
+                {
+                    private_op(_encrypted.data[i], tmp.plain);
+                    decrypted[i] = decode_block(tmp.plain.template convert_to<std::string>());
+                }
+            });
+
+            batch_t<char_type> result;
+            result.offsets.reserve(offsets.size());
+
+            size_t size = 0;
+
+            for (const auto& block : decrypted) {
+                size += block.size();
+            }
+
+            result.data.reserve(size);
+
+            for (size_t i = 1; i < offsets.size(); ++i)
+            {
+                for (size_t j = offsets[i - 1]; j < offsets[i]; ++j) {
+                    result.data.insert(result.data.end(), decrypted[j].begin(), decrypted[j].end());
+                }
+
+                result.offsets.push_back(result.data.size());
+            }
+
+            return result;
+        }
+
+        // Runs setup() on the executor, this object has to outlive the future. On the library pool it is queued behind
+        // the request path work, so yield_to_urgent() never picks up a whole key generation
+        _NODISCARD std::future<void> setup_async()
+        {
+            const detail::priority_scope background(detail::priority::background);
+
+            return detail::run_async(get_executor(), [this]() { setup(); });
+        }
+
+        // Runs setup() on the executor and calls done(setupdone(), nullptr) on its thread, queued like setup_async()
+        template <class Fn>
+        void setup_async(Fn&& _done)
+        {
+            const detail::priority_scope background(detail::priority::background);
+
+            get_executor()([this, done = std::forward<Fn>(_done)]() mutable
+            {
+                setup();
+                done(setupdone(), std::exception_ptr());
+            });
+        }
+
+        // Encrypts a copy of X on the executor
+        _NODISCARD std::future<std::vector<number_t>> encrypt_async(string _str, const std::tuple<uint32_t&, number_t&>& _public_key)
+        {
+            return detail::run_async(get_executor(), [this, str = std::move(_str), e = std::get<0>(_public_key), n = std::get<1>(_public_key)]() mutable
+            {
+                return encrypt(str, std::tie(e, n));
+            });
+        }
+
+        // Encrypts a copy of X on the executor and calls done(blocks, error) on its thread
+        template <class Fn>
+        void encrypt_async(string _str, const std::tuple<uint32_t&, number_t&>& _public_key, Fn&& _done)
+        {
+            get_executor()([this, str = std::move(_str), e = std::get<0>(_public_key), n = std::get<1>(_public_key), done = std::forward<Fn>(_done)]() mutable
+            {
+                std::vector<number_t> result;
+                std::exception_ptr error;
+
+                try {
+                    result = encrypt(str, std::tie(e, n));
+                }
+                catch (...) {
+                    error = std::current_exception();
+                }
+
+                done(std::move(result), error);
+            });
+        }
+
+        // Decrypts X on the executor
+        _NODISCARD std::future<string> decrypt_async(std::vector<number_t> _encrypted) const
+        {
+            return detail::run_async(get_executor(), [this, encrypted = std::move(_encrypted)]() mutable
+            {
+                return decrypt(encrypted);
+            });
+        }
+
+        // Decrypts X on the executor and calls done(str, error) on its thread
+        template <class Fn>
+        void decrypt_async(std::vector<number_t> _encrypted, Fn&& _done) const
+        {
+            get_executor()([this, encrypted = std::move(_encrypted), done = std::forward<Fn>(_done)]() mutable
+            {
+                string result;
+                std::exception_ptr error;
+
+                try {
+                    result = decrypt(encrypted);
+                }
+                catch (...) {
+                    error = std::current_exception();
+                }
+
+                done(std::move(result), error);
+            });
+        }
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+        // co_await rsa.co_setup(), resumes with setupdone()
+        _NODISCARD auto co_setup()
+        {
+            auto start = [this](auto _done) { setup_async(std::move(_done)); };
+            return awaitable<bool, decltype(start)>(std::move(start));
+        }
+
+        // co_await rsa.co_encrypt(str, key), resumes with the encrypted blocks
+        _NODISCARD auto co_encrypt(string _str, const std::tuple<uint32_t&, number_t&>& _public_key)
+        {
+            auto start = [this, str = std::move(_str), e = std::get<0>(_public_key), n = std::get<1>(_public_key)](auto _done) mutable
+            {
+                encrypt_async(std::move(str), std::tie(e, n), std::move(_done));
+            };
+            return awaitable<std::vector<number_t>, decltype(start)>(std::move(start));
+        }
+
+        // co_await rsa.co_decrypt(blocks), resumes with the decrypted string
+        _NODISCARD auto co_decrypt(std::vector<number_t> _encrypted) const
+        {
+            auto start = [this, encrypted = std::move(_encrypted)](auto _done) mutable
+            {
+                decrypt_async(std::move(encrypted), std::move(_done));
+            };
+            return awaitable<string, decltype(start)>(std::move(start));
+        }
+#endif
+
+        // Immutable copy of the public key that can be shared between threads
+        _NODISCARD basic_public_key<char_type, throw_errors> make_public_key() const
+        {
+            check_setup();
+
+            return basic_public_key<char_type, throw_errors>(n, e, m_bits, m_utf8, m_compress);
+        }
+
+        // Immutable copy of the whole key with its blinding pool that can be shared between threads
+        _NODISCARD basic_private_key<char_type, throw_errors> make_private_key() const
+        {
+            check_private();
+
+            return basic_private_key<char_type, throw_errors>(*this);
+        }
+
+        // Signs a string with the private key (RSASSA-PKCS1-v1_5 with SHA-256)
+        _NODISCARD number_t sign(const string_view& _str) const
+        {
+            check_private();
+
+            const auto em = emsa_pkcs1(hash_string(_str), detail::byte_length(n));
+
+            if (em.empty()) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Key is too small for SHA-256 signatures");
+                }
+                return 0;
+            }
+
+            const number_t message = detail::from_bytes(em.data(), em.size());
+            number_t signature = private_op(message);
+
+            // A faulty CRT result would leak a factor of n, so check it with the public key
+            if (boost::multiprecision::powm(signature, e, n) != message) {
+                signature = boost::multiprecision::powm(message, private_parts().d, n);
+            }
+
+            return signature;
+        }
+
+        // Verifies the signature of a string with a public key
+        _NODISCARD bool verify(const string_view& _str, const number_t& _signature, const std::tuple<uint32_t&, number_t&>& _public_key) const
+        {
+            return verify_with(_str, _signature, std::get<0>(_public_key), std::get<1>(_public_key));
+        }
+
+        // Verifies many signatures with one public key, split across the workers
+        _NODISCARD std::vector<bool> verify_batch(const std::vector<std::pair<string_view, number_t>>& _signed, const std::tuple<uint32_t&, number_t&>& _public_key) const
+        {
+            const uint32_t e = std::get<0>(_public_key);
+            const number_t& n = std::get<1>(_public_key);
+
+            if (_signed.empty()) {
+                return { };
+            }
+
+            // The encoded messages only differ in the hash, so the padding is built once for all pairs
+            const auto em = emsa_pkcs1({ }, detail::byte_length(n));
+
+            if (em.empty()) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Key is too small for SHA-256 signatures");
+                }
+                return std::vector<bool>(_signed.size(), false);
+            }
+
+            std::vector<uint8_t> verified(_signed.size(), 0);
+
+            parallel_chunks(get_executor(), _signed.size(), detail::cost_model::key(detail::cost_op::verify, em.size()), [&_signed, &em, e, &n, &verified](const size_t _begin, const size_t _end)
+            {
+                std::vector<uint8_t> expected = em, decoded(em.size());
+                number_t scratch;
+
+                for (size_t i = _begin; i < _end; ++i) {
+                    verified[i] = verify_signature(_signed[i].first, _signed[i].second, e, n, expected, decoded, scratch);
+                }
+            });
+
+            return std::vector<bool>(verified.begin(), verified.end());
+        }
+
+        // Encrypts a string with one RSA operation (RSA-KEM) and ChaCha20-Poly1305 for the payload
+        _NODISCARD hybrid_t encrypt_hybrid(const string_view& _str, const std::tuple<uint32_t&, number_t&>& _public_key) const
+        {
+            check_setup();
+
+            return encrypt_hybrid_with(_str, std::get<0>(_public_key), std::get<1>(_public_key), m_utf8);
+        }
+
+        // Decrypts a hybrid ciphertext
+        _NODISCARD string decrypt(const hybrid_t& _encrypted) const
+        {
+            RSA_METRIC_SCOPE(decrypt);
+            RSA_TRACE_SCOPE("decrypt_hybrid");
+
+            check_private();
+
+            const size_t k = detail::byte_length(n);
+
+            if (_encrypted.key <= 0 || _encrypted.key >= n) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Invalid hybrid ciphertext");
+                }
+                return { };
+            }
+
+            uint8_t key[32];
+            derive_hybrid_key(private_op(_encrypted.key), k, key);
+
+            const uint8_t nonce[12] = { };
+            const auto tag = detail::aead_tag(key, nonce, _encrypted.payload.data(), _encrypted.payload.size());
+
+            if (!detail::equal_ct(tag.data(), _encrypted.tag.data(), tag.size())) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Hybrid ciphertext authentication failed");
+                }
+                return { };
+            }
+
+            std::vector<uint8_t> bytes = _encrypted.payload;
+            detail::chacha20(key, nonce, 1).apply(bytes.data(), bytes.size());
+
+            string decrypted;
+
+            if (!text_from_bytes(bytes.data(), bytes.size(), decrypted)) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Invalid hybrid ciphertext");
+                }
+                return { };
+            }
+
+            return decrypted;
+        }
+
+        // Encrypts a string into RSAES-OAEP blocks (SHA-256, MGF1), every block has the byte size of n and they are stored back to back
+        _NODISCARD std::vector<uint8_t> encrypt_oaep(const string_view& _str, const std::tuple<uint32_t&, number_t&>& _public_key, const std::string_view& _label = { }) const
+        {
+            check_setup();
+
+            return encrypt_oaep_with(_str, std::get<0>(_public_key), std::get<1>(_public_key), _label, m_utf8, get_executor());
+        }
+
+        // Decrypts RSAES-OAEP blocks from encrypt_oaep()
+        _NODISCARD string decrypt_oaep(const std::vector<uint8_t>& _encrypted, const std::string_view& _label = { }) const
+        {
+            RSA_METRIC_SCOPE(decrypt);
+            RSA_TRACE_SCOPE("decrypt_oaep");
+
+            check_private();
+
+            constexpr size_t hlen = std::tuple_size_v<detail::sha256::digest_t>;
+
+            const size_t k = detail::byte_length(n);
+
+            if (k < 2 * hlen + 3 || _encrypted.empty() || _encrypted.size() % k != 0) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Invalid OAEP ciphertext");
+                }
+                return { };
+            }
+
+            const size_t count = _encrypted.size() / k;
+            const size_t db_size = k - hlen - 1;
+
+            std::vector<uint8_t> encoded(_encrypted.size());
+            std::atomic<bool> valid = true;
+
+            parallel_chunks(get_executor(), count, detail::cost_model::key(detail::cost_op::private_block, k), [this, &_encrypted, &encoded, &valid, k](const size_t _begin, const size_t _end)
+            {
+                for (size_t i = _begin; i < _end; ++i)
+                {
+                    const number_t block = detail::from_bytes(_encrypted.data() + i * k, k);
+
+                    if (block >= n) {
+                        valid = false;
+                        continue;
+                    }
+
+                    detail::to_bytes(private_op(block), encoded.data() + i * k, k);
+                }
+            });
+
+            const auto seed_masks = detail::mgf1_sha256(encoded.data() + 1 + hlen, db_size, k, count, hlen);
+
+            for (size_t i = 0; i < count; ++i) {
+                for (size_t j = 0; j < hlen; ++j) {
+                    encoded[i * k + 1 + j] ^= seed_masks[i * hlen + j];
+                }
+            }
+
+            const auto db_masks = detail::mgf1_sha256(encoded.data() + 1, hlen, k, count, db_size);
+            const auto lhash = detail::sha256::hash(_label.data(), _label.size());
+
+            // All blocks are checked and only one error is reported, so a failure doesn`t tell which check went wrong.
+            // The padding is scanned in full with masks and nothing is copied before the result of all checks is known,
+            // so neither the time nor the memory access depends on where the separator is or if the padding is valid
+            size_t decoded = detail::zero_mask_ct(static_cast<size_t>(!valid));
+            std::vector<size_t> starts(count);
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                uint8_t* em = encoded.data() + i * k;
+                uint8_t* db = em + 1 + hlen;
+
+                for (size_t j = 0; j < db_size; ++j) {
+                    db[j] ^= db_masks[i * db_size + j];
+                }
+
+                // found is set from the first 0x01 on, any byte other than 0x00 before it is an error
+                size_t found = 0, invalid = 0, start = db_size;
+
+                for (size_t j = hlen; j < db_size; ++j)
+                {
+                    const size_t is_zero = detail::zero_mask_ct(db[j]);
+                    const size_t is_one = detail::zero_mask_ct(db[j] ^ 0x01u);
+
+                    start = detail::select_ct(~found & is_one, j + 1, start);
+                    invalid |= ~found & ~is_zero & ~is_one;
+                    found |= is_one;
+                }
+
+                decoded &= detail::zero_mask_ct(em[0]);
+                decoded &= detail::zero_mask_ct(detail::diff_ct(db, lhash.data(), hlen));
+                decoded &= found & ~invalid;
+
+                starts[i] = start;
+            }
+
+            std::vector<uint8_t> bytes;
+
+            if (decoded != 0)
+            {
+                bytes.reserve(count * (k - 2 * hlen - 2));
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const uint8_t* db = encoded.data() + i * k + 1 + hlen;
+                    bytes.insert(bytes.end(), db + starts[i], db + db_size);
+                }
+            }
+
+            string decrypted;
+
+            if (decoded == 0 || !text_from_bytes(bytes.data(), bytes.size(), decrypted)) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("OAEP decoding error");
+                }
+                return { };
+            }
+
+            return decrypted;
+        }
+
+    private:
+        // Check if setup() has been called
+        void __forceinline check_setup() const
+        {
+            if (m_setupdone == false) {
+                throw std::exception("You have to call setup() before you use the class");
+            }
+        } 
+
+        // Check if the private key is available for private key operations
+        void check_private() const
+        {
+            check_setup();
+
+            if (!has_private_key()) {
+                throw std::runtime_error("The private key is not available, only a public key was imported");
+            }
+        }
+
+        // PEM label of a key format
+        _NODISCARD static constexpr std::string_view pem_label(const key_format _format) noexcept
+        {
+            switch (_format)
+            {
+            case key_format::pkcs1_private: return "RSA PRIVATE KEY";
+            case key_format::pkcs8_private: return "PRIVATE KEY";
+            case key_format::pkcs1_public: return "RSA PUBLIC KEY";
+            default: return "PUBLIC KEY";
+            }
+        }
+
+        // Check an AlgorithmIdentifier for rsaEncryption, the NULL parameters are optional
+        _NODISCARD static bool is_rsa_algorithm(detail::der_reader _algorithm) noexcept
+        {
+            using der = detail::der_reader;
+
+            constexpr size_t oid_offset = 4, oid_size = 9;
+
+            der oid, params;
+
+            if (!_algorithm.read(der::OBJECT_ID, oid) || oid.size() != oid_size || std::memcmp(oid.data(), detail::RSA_ALGORITHM_ID + oid_offset, oid_size) != 0) {
+                return false;
+            }
+
+            return _algorithm.empty() || (_algorithm.read(der::NULL_TAG, params) && params.empty() && _algorithm.empty());
+        }
+
+        // Import a PKCS#1 RSAPrivateKey or RSAPublicKey
+        bool import_pkcs1(const uint8_t* _data, const size_t _size)
+        {
+            using der = detail::der_reader;
+
+            der input(_data, _size), body;
+
+            if (!input.read(der::SEQUENCE, body) || !input.empty()) {
+                return false;
+            }
+
+            // RSAPublicKey has 2 INTEGERs, a two prime RSAPrivateKey has 9
+            size_t count = 0;
+
+            for (der probe = body, skipped; probe.read(der::INTEGER, skipped);) {
+                ++count;
+            }
+
+            uint32_t version = 0, _e = 0;
+            number_t values[7];
+
+            if (count == 2)
+            {
+                if (!body.integer(values[2]) || !body.integer(_e)) {
+                    return false;
+                }
+            }
+            else if (count == 9)
+            {
+                // values: p, q, n, d, dp, dq, qinv
+                if (!body.integer(version) || version != 0 || !body.integer(values[2]) || !body.integer(_e) || !body.integer(values[3])) {
+                    return false;
+                }
+
+                for (const size_t i : { 0, 1, 4, 5, 6 }) {
+                    if (!body.integer(values[i])) {
+                        return false;
+                    }
+                }
+
+                if (values[0] * values[1] != values[2]) {
+                    return false;
+                }
+            }
+            else {
+                return false;
+            }
+
+            if (!body.empty() || _e < 3 || values[2] < 3) {
+                return false;
+            }
+
+            p = std::move(values[0]);
+            q = std::move(values[1]);
+            n = std::move(values[2]);
+            d = std::move(values[3]);
+            dp = std::move(values[4]);
+            dq = std::move(values[5]);
+            qinv = std::move(values[6]);
+            e = _e;
+
+            set(static_cast<uint32_t>(detail::byte_length(n) * 8));
+
+            reset_key_state(count == 9);
+
+            m_setupdone = true;
+
+            return true;
+        }
+
+        // Calculate the CRT parameters from p, q and d
+        void compute_crt()
+        {
+            dp = d % (p - 1);
+            dq = d % (q - 1);
+            qinv = inverse_mod(q, p);
+
+            reset_key_state(true);
+        }
+
+        // The key changed, drop lazily decoded parts and start a new blinding pool for private keys
+        void reset_key_state(const bool _has_private)
+        {
+            m_lazy.reset();
+
+            if (_has_private) {
+                m_blinding_pool = std::make_shared<detail::blinding_pool>(n, e);
+            }
+            else {
+                m_blinding_pool.reset();
+            }
+        }
+
+        // References to the private key parts
+        struct private_parts_t
+        {
+            const number_t& p;
+            const number_t& q;
+            const number_t& d;
+            const number_t& dp;
+            const number_t& dq;
+            const number_t& qinv;
+        };
+
+        // The private key parts, keys imported from a mapped file decode them here on first use
+        _NODISCARD private_parts_t private_parts() const
+        {
+            if (m_lazy) {
+                m_lazy->materialize();
+                return { m_lazy->p, m_lazy->q, m_lazy->d, m_lazy->dp, m_lazy->dq, m_lazy->qinv };
+            }
+
+            return { p, q, d, dp, dq, qinv };
+        }
+
+        // Import a binary key from a mapped file, only n and e are read now and the private parts
+        // are decoded by the first private key operation, the mapping is kept alive by this object.
+        // p, q, d and the CRT members stay 0, so only keystore::load_private_key() uses this for keys
+        // whose members can`t be reached
+        bool import_binary(std::shared_ptr<const detail::mapped_file> _file, const uint8_t* _data, const size_t _size)
+        {
+            RSA_METRIC_SCOPE(import);
+
+            if (!_file || !check_binary(_data, _size)) {
+                return false;
+            }
+
+            const uint32_t flags = detail::load_le32(_data + 16);
+
+            if ((flags & BINARY_PRIVATE) == 0) {
+                return import_binary(_data, _size);
+            }
+
+            const uint8_t* end = _data + _size - 8;
+            const uint8_t* limbs = _data + BINARY_HEADER;
+            const uint8_t* ptr = limbs;
+
+            number_t _n;
+
+            // Only n is decoded, but all seven records (p, q, n, d, dp, dq, qinv) have to fit exactly like for
+            // the eager import, so materialize() can`t run into a broken layout later
+            for (uint32_t i = 0; i < 7; ++i)
+            {
+                if (!((i == 2) ? detail::read_limbs(ptr, end, _n) : detail::skip_limbs(ptr, end))) {
+                    return false;
+                }
+            }
+
+            if (ptr != end) {
+                return false;
+            }
+
+            n = std::move(_n);
+            p = q = d = dp = dq = qinv = 0;
+
+            e = detail::load_le32(_data + 12);
+            m_bits = detail::load_le32(_data + 8);
+
+            set(m_bits);
+
+            reset_key_state(true);
+            m_lazy = std::make_shared<detail::lazy_private>(std::move(_file), limbs, end);
+
+            m_setupdone = true;
+
+            return true;
+        }
+
+        // Check the header and checksum of a binary key
+        _NODISCARD static bool check_binary(const uint8_t* _data, const size_t _size) noexcept
+        {
+            if (_data == nullptr || _size < BINARY_HEADER + 8 || std::memcmp(_data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0) {
+                return false;
+            }
+
+            if (detail::load_le32(_data + 4) != (BINARY_VERSION | (64 << 16)) || (detail::load_le32(_data + 16) & ~BINARY_PRIVATE) != 0) {
+                return false;
+            }
+
+            return detail::fnv1a64(_data, _size - 8) == detail::load_le64(_data + _size - 8);
+        }
+
+        // Numbers the block operations work in and the digits of a block, one set per thread that every call reuses
+        struct scratch_t
+        {
+            number_t block, blinded, m1, m2, h, plain;
+            std::string digits;
+        };
+
+        _NODISCARD static scratch_t& scratch() noexcept
+        {
+            static thread_local scratch_t numbers;
+            return numbers;
+        }
+
+        // Private key operation, blinded with a pair from the pool when blinding is on
+        _NODISCARD number_t private_op(const number_t& _num) const
+        {
+            number_t result;
+            private_op(_num, result);
+            return result;
+        }
+
+        // Private key operation into X, X must not be a number of scratch() other than plain
+        void private_op(const number_t& _num, number_t& _out) const
+        {
+            RSA_METRIC_SCOPE(block);
+            RSA_TRACE_SCOPE("private_block");
+
+            auto& tmp = scratch();
+
+            if (m_blinding == false || !m_blinding_pool) {
+                private_crt(_num, _out, tmp);
+                return;
+            }
+
+            const auto pair = m_blinding_pool->take([this]() { return get_executor(); });
+
+            tmp.blinded = _num * pair.first;
+            tmp.blinded %= n;
+
+            private_crt(tmp.blinded, _out, tmp);
+
+            _out *= pair.second;
+            _out %= n;
+        }
+
+        // Private key operation X^d mod n with the CRT parameters, the input is read before X is written
+        void private_crt(const number_t& _num, number_t& _out, scratch_t& _tmp) const
+        {
+            const auto key = private_parts();
+
+            _tmp.m1 = boost::multiprecision::powm(_num, key.dp, key.p);
+            _tmp.m2 = boost::multiprecision::powm(_num, key.dq, key.q);
+
+            _tmp.h = _tmp.m1 - _tmp.m2;
+            _tmp.h *= key.qinv;
+            _tmp.h %= key.p;
+
+            if (_tmp.h < 0) {
+                _tmp.h += key.p;
+            }
+
+            _out = _tmp.h * key.q;
+            _out += _tmp.m2;
+        }
+
+        // SHA-256 of the raw bytes of a string
+        _NODISCARD static detail::sha256::digest_t hash_string(const string_view& _str) noexcept
+        {
+            return detail::sha256::hash(_str.data(), _str.size() * char_size);
+        }
+
+        // EMSA-PKCS1-v1_5 encoding of a SHA-256 hash with X bytes, empty if X is too small
+        _NODISCARD static std::vector<uint8_t> emsa_pkcs1(const detail::sha256::digest_t& _hash, const size_t _size)
+        {
+            constexpr size_t tlen = sizeof(SHA256_DIGEST_INFO) + std::tuple_size_v<detail::sha256::digest_t>;
+
+            if (_size < tlen + 11) {
+                return { };
+            }
+
+            std::vector<uint8_t> em(_size, 0xff);
+
+            em[0] = 0x00;
+            em[1] = 0x01;
+            em[_size - tlen - 1] = 0x00;
+
+            std::copy(std::begin(SHA256_DIGEST_INFO), std::end(SHA256_DIGEST_INFO), em.end() - tlen);
+            std::copy(_hash.begin(), _hash.end(), em.end() - _hash.size());
+
+            return em;
+        }
+
+        // Verify one signature, the hash of the string is written into the encoded message _expected
+        _NODISCARD static bool verify_signature(const string_view& _str, const number_t& _signature, const uint32_t _e, const number_t& _n, std::vector<uint8_t>& _expected, std::vector<uint8_t>& _decoded, number_t& _scratch)
+        {
+            if (_signature <= 0 || _signature >= _n) {
+                return false;
+            }
+
+            const auto hash = hash_string(_str);
+            std::copy(hash.begin(), hash.end(), _expected.end() - hash.size());
+
+            _scratch = boost::multiprecision::powm(_signature, _e, _n);
+
+            return detail::to_bytes(_scratch, _decoded.data(), _decoded.size()) && _decoded == _expected;
+        }
+
+        // Derive the ChaCha20-Poly1305 key from the RSA-KEM secret
+        static void derive_hybrid_key(const number_t& _secret, const size_t _size, uint8_t (&_key)[32])
+        {
+            std::vector<uint8_t> secret(_size);
+            detail::to_bytes(_secret, secret.data(), secret.size());
+            detail::kdf_sha256(secret.data(), secret.size(), _key, sizeof(_key));
+        }
+
+        // Encrypts a string (see basic_public_key)
+        _NODISCARD static std::vector<number_t> encrypt_with(const string_view& _str, const uint32_t _e, const number_t& _n, const uint32_t _bits, const bool _compress, const executor& _executor)
+        {
+            RSA_METRIC_SCOPE(encrypt);
+            RSA_TRACE_SCOPE("encrypt");
+
+            const uint32_t& e = _e;
+            const number_t& n = _n;
+
+            auto pow_block = [e, n](const number_t& _block) noexcept -> number_t {
+                RSA_METRIC_SCOPE(block);
+                RSA_TRACE_SCOPE("encrypt_block");
+                return boost::multiprecision::powm(_block, e, n);
+            };
+
+            if (_str.empty()) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Can`t Encrypt empty string");
+                }
+                return { };
+            }
+
+            string packed;
+            const auto blocks = create_blocks(pack_text(_str, _compress, packed), n, _bits);
+
+            std::vector<number_t> result(blocks.size());
+
+            parallel_chunks(_executor, blocks.size(), detail::cost_model::key(detail::cost_op::public_block, detail::byte_length(n)), [&blocks, &result, &pow_block](const size_t _begin, const size_t _end)
+            {
+                for (size_t i = _begin; i < _end; ++i) {
+                    result[i] = pow_block(blocks[i]);
+                }
+            });
+
+            return result;
+        }
+
+        // Encrypts a string into a packed_t (see encrypt_packed()). Only the block offsets are kept, every thread encodes
+        // a block into its scratch number and writes the result straight into its slot
+        _NODISCARD static packed_t encrypt_packed_with(const string_view& _str, const uint32_t _e, const number_t& _n, const uint32_t _bits, const bool _compress, const executor& _executor)
+        {
+            RSA_METRIC_SCOPE(encrypt);
+            RSA_TRACE_SCOPE("encrypt");
+
+            if (_str.empty()) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Can`t Encrypt empty string");
+                }
+                return { };
+            }
+
+            string packed;
+            const string_view message = pack_text(_str, _compress, packed);
+            const auto starts = split_blocks(message, _n, _bits, scratch());
+
+            packed_t result(starts.size(), packed_t::stride_for(_n));
+
+            parallel_chunks(_executor, starts.size(), detail::cost_model::key(detail::cost_op::public_block, detail::byte_length(_n)), [&message, &starts, &result, _e, &_n](const size_t _begin, const size_t _end)
+            {
+                auto& tmp = scratch();
+
+                for (size_t i = _begin; i < _end; ++i)
+                {
+                    RSA_METRIC_SCOPE(block);
+                    RSA_TRACE_SCOPE("encrypt_block");
+
+                    block_digits(message, starts[i], (i + 1 < starts.size()) ? starts[i + 1] : message.size(), tmp.digits);
+                    tmp.block.assign(tmp.digits);
+
+                    tmp.plain = boost::multiprecision::powm(tmp.block, _e, _n);
+                    result.set(i, tmp.plain);
+                }
+            });
+
+            return result;
+        }
+
+        // Encrypts many messages with one pass over all their blocks (see encrypt_batch())
+        _NODISCARD static batch_t<number_t> encrypt_batch_with(const span<const string_view>& _messages, const uint32_t _e, const number_t& _n, const uint32_t _bits, const executor& _executor)
+        {
+            RSA_METRIC_SCOPE(encrypt);
+            RSA_TRACE_SCOPE("encrypt_batch");
+
+            std::vector<std::vector<number_t>> blocks(_messages.size());
+
+            // Building the blocks is string work, so it is split across the threads as well
+            parallel_chunks(_executor, _messages.size(), detail::cost_model::key(detail::cost_op::encode, detail::byte_length(_n)), [&_messages, &blocks, &_n, _bits](const size_t _begin, const size_t _end)
+            {
+                for (size_t i = _begin; i < _end; ++i) {
+                    if (!_messages[i].empty()) {
+                        blocks[i] = create_blocks(_messages[i], _n, _bits);
+                    }
+                }
+            });
+
+            batch_t<number_t> result;
+            result.offsets.reserve(_messages.size() + 1);
+
+            size_t count = 0;
+
+            for (const auto& message : blocks) {
+                count += message.size();
+            }
+
+            result.data.reserve(count);
+
+            for (auto& message : blocks)
+            {
+                for (auto& block : message) {
+                    result.data.push_back(std::move(block));
+                }
+
+                result.offsets.push_back(result.data.size());
+            }
+
+            parallel_chunks(_executor, count, detail::cost_model::key(detail::cost_op::public_block, detail::byte_length(_n)), [&result, _e, &_n](const size_t _begin, const size_t _end)
+            {
+                for (size_t i = _begin; i < _end; ++i)
+                {
+                    RSA_METRIC_SCOPE(block);
+                    RSA_TRACE_SCOPE("encrypt_block");
+                    result.data[i] = boost::multiprecision::powm(result.data[i], _e, _n);
+                }
+            });
+
+            return result;
+        }
+
+        // Message for create_blocks(), with set_compression(true) a flag unit and then the text itself (0) or,
+        // if that is shorter, its LZ compressed bytes with one byte per unit (1)
+        _NODISCARD static string_view pack_text(const string_view& _str, const bool _compress, string& _buffer)
+        {
+            if (!_compress) {
+                return _str;
+            }
+
+            // Short messages don`t compress
+            if (_str.size() >= 32)
+            {
+                const auto packed = detail::lz_compress(reinterpret_cast<const uint8_t*>(_str.data()), _str.size() * char_size);
+
+                if (packed.size() < _str.size())
+                {
+                    _buffer.reserve(packed.size() + 1);
+                    _buffer.push_back(char_type(1));
+
+                    for (const uint8_t byte : packed) {
+                        _buffer.push_back(static_cast<char_type>(byte));
+                    }
+
+                    return _buffer;
+                }
+            }
+
+            _buffer.reserve(_str.size() + 1);
+            _buffer.push_back(char_type(0));
+            _buffer.append(_str);
+
+            return _buffer;
+        }
+
+        // Back from pack_text(), false for a damaged message
+        _NODISCARD bool unpack_text(string& _text) const
+        {
+            if (!m_compress) {
+                return true;
+            }
+
+            if (_text.empty() || (_text.front() != char_type(0) && _text.front() != char_type(1))) {
+                return false;
+            }
+
+            if (_text.front() == char_type(0)) {
+                _text.erase(0, 1);
+                return true;
+            }
+
+            std::vector<uint8_t> packed; packed.reserve(_text.size() - 1);
+
+            for (size_t i = 1; i < _text.size(); ++i)
+            {
+                const auto unit = static_cast<std::make_unsigned_t<char_type>>(_text[i]);
+
+                if (unit > 0xff) {
+                    return false;
+                }
+
+                packed.push_back(static_cast<uint8_t>(unit));
+            }
+
+            std::vector<uint8_t> bytes;
+
+            if (!detail::lz_decompress(packed.data(), packed.size(), bytes) || bytes.size() % char_size != 0) {
+                return false;
+            }
+
+            _text.assign(bytes.size() / char_size, char_type());
+            std::memcpy(_text.data(), bytes.data(), bytes.size());
+
+            return true;
+        }
+
+        // Bytes of a string for the byte oriented modes, with set_utf8(true) wide strings are converted into X first
+        _NODISCARD static bool text_bytes(const string_view& _str, const bool _utf8, std::string& _buffer, const uint8_t*& _bytes, size_t& _size)
+        {
+            _bytes = reinterpret_cast<const uint8_t*>(_str.data());
+            _size = _str.size() * char_size;
+
+            if constexpr (char_size > 1)
+            {
+                if (_utf8)
+                {
+                    if (!detail::to_utf8(_str.data(), _str.size(), _buffer)) {
+                        return false;
+                    }
+
+                    _bytes = reinterpret_cast<const uint8_t*>(_buffer.data());
+                    _size = _buffer.size();
+                }
+            }
+
+            return true;
+        }
+
+        // String from the bytes of text_bytes()
+        _NODISCARD bool text_from_bytes(const uint8_t* _bytes, const size_t _size, string& _out) const
+        {
+            if constexpr (char_size > 1)
+            {
+                if (m_utf8) {
+                    return detail::from_utf8(_bytes, _size, _out);
+                }
+            }
+
+            if (_size % char_size != 0) {
+                return false;
+            }
+
+            _out.assign(_size / char_size, char_type());
+            std::memcpy(_out.data(), _bytes, _size);
+
+            return true;
+        }
+
+        // Encrypts a string with one RSA operation (RSA-KEM) and ChaCha20-Poly1305 for the payload (see basic_public_key)
+        _NODISCARD static hybrid_t encrypt_hybrid_with(const string_view& _str, const uint32_t _e, const number_t& _n, const bool _utf8)
+        {
+            RSA_METRIC_SCOPE(encrypt);
+            RSA_TRACE_SCOPE("encrypt_hybrid");
+
+            if (_str.empty()) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Can`t Encrypt empty string");
+                }
+                return { };
+            }
+
+            const uint32_t e = _e;
+            const number_t& n = _n;
+            const size_t k = detail::byte_length(n);
+
+            // Random secret z in [2, n), the extra bytes keep the reduction close to uniform
+            std::vector<uint8_t> secret(k + 8);
+            number_t z;
+
+            do {
+                detail::random_bytes(secret.data(), secret.size());
+                z = detail::from_bytes(secret.data(), secret.size()) % n;
+            } while (z < 2);
+
+            hybrid_t result;
+            result.key = boost::multiprecision::powm(z, e, n);
+
+            uint8_t key[32];
+            derive_hybrid_key(z, k, key);
+
+            std::string utf8;
+            const uint8_t* bytes = nullptr;
+            size_t size = 0;
+
+            if (!text_bytes(_str, _utf8, utf8, bytes, size)) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Can`t convert the string to UTF-8");
+                }
+                return { };
+            }
+
+            result.payload.assign(bytes, bytes + size);
+
+            // Every message has a fresh key, so a zero nonce is never reused
+            const uint8_t nonce[12] = { };
+            detail::chacha20(key, nonce, 1).apply(result.payload.data(), result.payload.size());
+
+            result.tag = detail::aead_tag(key, nonce, result.payload.data(), result.payload.size());
+
+            return result;
+        }
+
+        // Encrypts a string into RSAES-OAEP blocks (SHA-256, MGF1), every block has the byte size of n and they are stored back to back (see basic_public_key)
+        _NODISCARD static std::vector<uint8_t> encrypt_oaep_with(const string_view& _str, const uint32_t _e, const number_t& _n, const std::string_view& _label, const bool _utf8, const executor& _executor)
+        {
+            RSA_METRIC_SCOPE(encrypt);
+            RSA_TRACE_SCOPE("encrypt_oaep");
+
+            if (_str.empty()) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Can`t Encrypt empty string");
+                }
+                return { };
+            }
+
+            const uint32_t e = _e;
+            const number_t& n = _n;
+
+            constexpr size_t hlen = std::tuple_size_v<detail::sha256::digest_t>;
+
+            const size_t k = detail::byte_length(n);
+
+            if (k < 2 * hlen + 3) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Key is too small for OAEP");
+                }
+                return { };
+            }
+
+            std::string utf8;
+            const uint8_t* bytes = nullptr;
+            size_t size = 0;
+
+            if (!text_bytes(_str, _utf8, utf8, bytes, size)) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Can`t convert the string to UTF-8");
+                }
+                return { };
+            }
+
+            const size_t capacity = k - 2 * hlen - 2;
+            const size_t count = (size + capacity - 1) / capacity;
+            const size_t db_size = k - hlen - 1;
+
+            // EM = 0x00 || maskedSeed || maskedDB, built in place in the output
+            std::vector<uint8_t> encrypted(count * k, 0);
+            std::vector<uint8_t> seeds(count * hlen);
+
+            detail::random_bytes(seeds.data(), seeds.size());
+
+            const auto lhash = detail::sha256::hash(_label.data(), _label.size());
+            const auto db_masks = detail::mgf1_sha256(seeds.data(), hlen, hlen, count, db_size);
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                uint8_t* db = encrypted.data() + i * k + 1 + hlen;
+
+                const size_t offset = i * capacity;
+                const size_t len = std::min(capacity, size - offset);
+
+                // DB = lHash || PS || 0x01 || M
+                std::copy(lhash.begin(), lhash.end(), db);
+                db[db_size - len - 1] = 0x01;
+                std::memcpy(db + db_size - len, bytes + offset, len);
+
+                for (size_t j = 0; j < db_size; ++j) {
+                    db[j] ^= db_masks[i * db_size + j];
+                }
+            }
+
+            // The seed masks depend on the masked data blocks, so they are hashed in a second batch
+            const auto seed_masks = detail::mgf1_sha256(encrypted.data() + 1 + hlen, db_size, k, count, hlen);
+
+            for (size_t i = 0; i < count; ++i) {
+                for (size_t j = 0; j < hlen; ++j) {
+                    encrypted[i * k + 1 + j] = seeds[i * hlen + j] ^ seed_masks[i * hlen + j];
+                }
+            }
+
+            parallel_chunks(_executor, count, detail::cost_model::key(detail::cost_op::public_block, k), [&encrypted, k, e, &n](const size_t _begin, const size_t _end)
+            {
+                number_t block;
+
+                for (size_t i = _begin; i < _end; ++i)
+                {
+                    uint8_t* data = encrypted.data() + i * k;
+
+                    RSA_METRIC_SCOPE(block);
+                    RSA_TRACE_SCOPE("encrypt_block");
+
+                    block = detail::from_bytes(data, k);
+                    block = boost::multiprecision::powm(block, e, n);
+                    detail::to_bytes(block, data, k);
+                }
+            });
+
+            return encrypted;
+        }
+
+        // Verifies the signature of a string with a public key (see basic_public_key)
+        _NODISCARD static bool verify_with(const string_view& _str, const number_t& _signature, const uint32_t _e, const number_t& _n)
+        {
+            const uint32_t e = _e;
+            const number_t& n = _n;
+
+            auto em = emsa_pkcs1({ }, detail::byte_length(n));
+
+            if (em.empty()) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("Key is too small for SHA-256 signatures");
+                }
+                return false;
+            }
+
+            std::vector<uint8_t> decoded(em.size());
+            number_t scratch;
+
+            return verify_signature(_str, _signature, e, n, em, decoded, scratch);
+        }
+
+        // Run fn(begin, end) over [0, X) inline or split into chunks on the executor. The measured cost of one item
+        // (see detail::cost_model) decides how many workers pay off. New work runs its first item inline as a warm up,
+        // e.g. for the blinding pool or a lazily loaded key, and measures the second one. Every run refines the cost
+        template <class Fn>
+        static void parallel_chunks(const executor& _executor, const size_t _count, const uint64_t _cost, Fn&& _fn)
+        {
+            if (_count == 0) {
+                return;
+            }
+
+            auto elapsed = [](const std::chrono::steady_clock::time_point& _start) -> double
+            {
+                return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - _start).count();
+            };
+
+            if (_executor.target<detail::inline_runner>() != nullptr) {
+                _fn(0, _count);
+                return;
+            }
+
+            auto& model = detail::cost_model::get();
+
+            size_t begin = 0;
+            double item = model.item(_cost);
+
+            if (item == 0)
+            {
+                _fn(0, 1);
+
+                if (_count == 1) {
+                    return;
+                }
+
+                const auto start = std::chrono::steady_clock::now();
+                _fn(1, 2);
+
+                item = elapsed(start);
+                model.update(_cost, item);
+
+                begin = 2;
+            }
+
+            const size_t remaining = _count - begin;
+
+            if (remaining == 0) {
+                return;
+            }
+
+            const size_t workers = model.workers(_executor, item * remaining, std::min<size_t>(get_thread_count(), remaining));
+
+            if (workers <= 1)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                _fn(begin, _count);
+
+                model.update(_cost, elapsed(start) / remaining);
+                return;
+            }
+
+            const size_t chunk = (remaining + workers - 1) / workers;
+
+            // Wall time of every chunk added up, the same as wall time * workers when the workers really run side by
+            // side, and not inflated when the calling thread ended up running most chunks itself
+            std::atomic<uint64_t> busy = 0;
+
+            const double latency = detail::run_tasks(_executor, (remaining + chunk - 1) / chunk, [&_fn, &busy, &elapsed, begin, chunk, _count](const size_t _index)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                const size_t first = begin + _index * chunk;
+
+                _fn(first, std::min(first + chunk, _count));
+
+                busy.fetch_add(static_cast<uint64_t>(elapsed(start)), std::memory_order_relaxed);
+            });
+
+            model.update(_cost, static_cast<double>(busy.load()) / remaining);
+            model.update_dispatch(_executor, latency);
+        }
+
+        // Decodes the digits of a decrypted block (see create_blocks())
+        _NODISCARD static string decode_block(const std::string& _decrypted)
+        {
+            string result; result.reserve(_decrypted.size());
+
+            for (uint32_t i = 0; _decrypted.at(i) != '0' || i > _decrypted.size();)
+            {
+                uint8_t _len = _decrypted.at(i++) - '0';
+
+                if (_decrypted.at(i) == '0' && _len > 1) {
+                    const auto _chr = _decrypted.substr(++i, --_len);
+                    // Parsed wider, the magnitude of the smallest value (e.g. -128 for char) doesn`t fit into char_type
+                    const auto _dec = static_cast<char_type>(-static_cast<int64_t>(detail::dton<uint64_t>(_chr.data())));
+                    result.push_back(_dec);
+                }
+                else {
+                    const auto _chr = _decrypted.substr(i, _len);
+                    const auto _dec = detail::dton<char_type>(_chr.data());
+                    result.push_back(_dec);
+                }
+
+                i += _len;
+            }
+
+            return result;
+        }
+
+        // Creates the blocks for encryption
+        _NODISCARD static std::vector<number_t> create_blocks(const string_view& _str, const number_t& _n, const uint32_t _keysize) noexcept
+        {
+            uint32_t blocksize = std::max(_keysize, MIN_BLOCKSIZE);
+
+            std::vector<number_t> blocks;
+            std::string msg; msg.reserve(blocksize * char_size);
+            uint32_t i = 0;
+
+            auto check_for_n = [_n, &blocksize](const number_t& _check) noexcept -> bool
+            {
+                if (_n < _check) {
+                    blocksize -= one_in_block_size;
+                    return false;
+                }
+                else {
+                    return true;
+                }
+            };
+
+            auto push_block = [&msg, &blocks, &i, check_for_n]() noexcept -> bool
+            {
+                number_t block(msg);
+
+                const bool valid = check_for_n(block);
+
+                if (valid) {
+                    blocks.push_back(block);
+                }
+                else {
+                    i = 0;
+                    blocks.clear();
+                }
+
+                msg.clear();
+
+                return valid;
+            };
+
+            while (true)
+            {
+                const std::string    num = std::to_string(_str.at(i));
+                const bool      negative = (num.front() == '-');
+                const uint32_t  nextsize = msg.size() + num.size() + static_cast<int32_t>(negative) + 1;
+
+                if (nextsize > blocksize) {
+                    msg.push_back('0');
+                    if (!push_block())
+                        continue;
+                }
+
+                msg.append( std::to_string(num.size()) );
+
+                if (negative) {
+                    msg.push_back('0');
+                    msg.append(num.substr(1));
+                }
+                else {
+                    msg.append(num);
+                }
+
+                if (++i == _str.size()) {
+                    msg.push_back('0');
+                    if (!push_block()) {
                         continue;
+                    }
+                    else {
+                        break;
+                    }
+                }
+            }
+
+            return blocks;
+        }
+
+        // Digits of the characters [Y, Z) of X as create_blocks() writes them into one block, including the closing 0
+        static void block_digits(const string_view& _str, const size_t _begin, const size_t _end, std::string& _out)
+        {
+            _out.clear();
+
+            for (size_t i = _begin; i < _end; ++i)
+            {
+                const std::string num = std::to_string(_str[i]);
+
+                _out.append(std::to_string(num.size()));
+
+                if (num.front() == '-') {
+                    _out.push_back('0');
+                    _out.append(num, 1, std::string::npos);
+                }
+                else {
+                    _out.append(num);
+                }
+            }
+
+            _out.push_back('0');
+        }
+
+        // The blocks of create_blocks() as offsets without building them: block i holds the characters [starts[i], starts[i + 1])
+        // and the last one runs to the end of X. The checks against n reuse the block number and digits of the scratch
+        _NODISCARD static std::vector<size_t> split_blocks(const string_view& _str, const number_t& _n, const uint32_t _keysize, scratch_t& _tmp)
+        {
+            uint32_t blocksize = std::max(_keysize, MIN_BLOCKSIZE);
+
+            std::vector<size_t> starts;
+
+            auto fits = [&_str, &_n, &_tmp](const size_t _begin, const size_t _end) -> bool
+            {
+                block_digits(_str, _begin, _end, _tmp.digits);
+                _tmp.block.assign(_tmp.digits);
+
+                return !(_n < _tmp.block);
+            };
+
+            while (true)
+            {
+                starts.assign(1, 0);
+
+                // Digits of the current block without its closing 0
+                size_t size = 0;
+                bool valid = true;
+
+                for (size_t i = 0; i < _str.size() && valid; ++i)
+                {
+                    const std::string num = std::to_string(_str[i]);
+                    const bool negative = (num.front() == '-');
+
+                    if (size + num.size() + static_cast<size_t>(negative) + 1 > blocksize)
+                    {
+                        valid = fits(starts.back(), i);
+                        starts.push_back(i);
+                        size = 0;
+                    }
+
+                    size += std::to_string(num.size()).size() + num.size();
+                }
+
+                if (valid && fits(starts.back(), _str.size())) {
+                    return starts;
+                }
+
+                blocksize -= one_in_block_size;
+            }
+        }
+
+        // Calculate the extended Euclidean algorithm
+        _NODISCARD static number_t egcd(const number_t& a, const number_t& b, number_t& x, number_t& y) noexcept
+        {
+            if (a == 0) {
+                x = 0;
+                y = 1;
+                return b;
+            }
+            
+            number_t x1, y1;
+            number_t gcd = egcd(b % a, a, x1, y1);
+
+            x = y1 - (b / a) * x1;
+            y = x1;
+
+            return gcd;
+        };
+
+        // Calculate modular multiplicative inverse of e and phi
+        _NODISCARD static number_t inverse_mod(const number_t& e, const number_t& phi) noexcept
+        {
+            number_t x = 0, y = 0;
+            if (egcd(e, phi, x, y) == 1) {
+                return ((x % phi) + phi) % phi;
+            }
+            return 0;
+        }
+
+        // Generate random primelike string with X bits
+        _NODISCARD static std::string random_primish_number(const uint32_t _bits) noexcept
+        {
+            std::mt19937_64 gen(std::random_device{ }());
+            std::uniform_int_distribution<int32_t> dist('0', '9');
+
+            const uint32_t bytes = _bits / 8;
+
+            std::string str(bytes, 0);
+
+            for (char& ch : str) {
+                ch = static_cast<char>(dist(gen));
+            }
+
+            while (str.front() == '0') {
+                str.front() = static_cast<char>(dist(gen));
+            }
+
+            while (str.back() != '1' && str.back() != '3' && str.back() != '7' && str.back() != '9') {
+                str.back() = static_cast<char>(dist(gen));
+            }
+
+            return str;
+        }
+
+        // Generate 2 primes p and q
+        _NODISCARD static std::pair<number_t, number_t> generate_prime_pair(const uint32_t _bits, const uint32_t _trys, const executor& _executor) noexcept
+        {
+            RSA_TRACE_SCOPE("generate_prime_pair");
+
+            auto search_thread = [_trys](const uint32_t bits, number_t& X, std::mutex& lock) noexcept -> void
+            {
+                RSA_TRACE_SCOPE("prime_search");
+
+                number_t possible_prime;
+
+                while (X.is_zero())
+                {
+                    // A search runs until a prime is found, so waiting requests get the worker between candidates
+                    detail::yield_to_urgent();
+
+                    RSA_TRACE_SCOPE("candidate");
+
+                    possible_prime.assign(random_primish_number(bits));
+
+                    if (is_prime(possible_prime, _trys))
+                    {
+                        {
+                            RSA_TRACE_SCOPE("prime_lock_wait");
+                            lock.lock();
+                        }
+                        {
+                            if (X.is_zero())
+                                X = possible_prime;
+                        }
+                        lock.unlock();
+
+                        return;
+                    }
+                }
+            };
+
+            // Half of the workers search p and the other half q, at least one each
+            const uint32_t threads_per = std::max(get_thread_count() / 2, 1u);
+
+            number_t p = 0, q = 0;
+
+            std::mt19937_64 mt(std::random_device{ }());
+            std::uniform_int_distribution<int32_t> dist(((_bits / 64) * -1) - 8, (_bits / 64) + 8);
+
+            const int32_t _SP = _bits + dist(mt), _SQ = _bits + dist(mt);
+
+            std::mutex p_lock;
+            std::mutex q_lock;
+
+            // Even tasks search p and odd ones q, a search that starts after its prime was found returns at once.
+            // They go to the background lane, so encryption and decryption of other keys run first
+            detail::priority_scope background(detail::priority::background);
+
+            detail::run_tasks(_executor, 2 * threads_per, [&](const size_t _index)
+            {
+                if (_index % 2 == 0) {
+                    search_thread(_SP, p, p_lock);
+                }
+                else {
+                    search_thread(_SQ, q, q_lock);
+                }
+            });
+
+            return std::make_pair(std::move(p), std::move(q));
+        }
+
+        // Miller Rabin test num X with Y tests
+        _NODISCARD static bool miller_rabin(const number_t& _num, const uint32_t _trys) noexcept
+        {
+            const number_t d_base = _num - 1;
+            number_t d = d_base;
+
+            uint32_t _divides = 0;
+            while (d % 2 == 0) {
+                d /= 2;
+                ++_divides;
+            }
+
+            std::mt19937_64 mt(std::random_device{ }());
+            boost::random::uniform_int_distribution<number_t> dist(2, _num - 2);
+
+            for (uint32_t i = 0; i < _trys; ++i)
+            {
+                const number_t rand = dist(mt);
+                number_t x = boost::multiprecision::powm(rand, d, _num);
+
+                if (x == 1 || x == d_base)
+                    continue;
+
+                bool not_prime = true;
+
+                for (uint32_t j = 1; j < _divides; ++j)
+                {
+                    x = (x * x) % _num;
+
+                    if (x == d_base) {
+                        not_prime = false;
+                        break;
+                    }
+                }
+
+                if (not_prime)
+                    return false;
+            }
+
+            return true;
+        }
+
+        // Check if X number is prime with Y Miller Rabin tests
+        _NODISCARD static bool is_prime(const number_t& _num, const uint32_t _trys) noexcept
+        {
+            if (_num == 2 || _num == 3)
+                return true;
+
+            if (_num <= 1 || _num % 2 == 0 || _num % 3 == 0)
+                return false;
+
+            for (uint64_t i = 5; i < 1000; i += 6) {
+                if (_num % i == 0 || _num % (i + 2) == 0)
+                    return false;
+            }
+
+            return miller_rabin(_num, _trys);
+        }
+
+        // Get a good amouth of Miller Rabin test for X bits
+        _NODISCARD static uint32_t get_rabin_trys(const uint64_t _bits) noexcept
+        {
+            return static_cast<uint32_t>(2 + std::log2(std::sqrt(_bits)) * 3.0);
+        }
+
+        // Output for RSA class
+        template<class ostream>
+        friend ostream& operator<<(ostream& out, const basic_rsa& rsa)
+        {
+            out << "Charset  : " << typeid(char_type).name() << '\n';
+            out << "Keysize  : " << rsa.keysize() << '\n';
+            out << "Trys     : " << rsa.trys() << '\n';
+            out << "Precision: " << rsa.precision() << '%' << '\n';
+            out << "Setupdone: " << (rsa.setupdone() == true ? "true" : "false") << "\n\n";
+
+            const auto key = rsa.private_parts();
+
+            out << "P: " << key.p << "\n\n";
+            out << "Q: " << key.q << "\n\n";
+            out << "N: " << rsa.n << "\n\n";
+            out << "E: " << rsa.e << "\n\n";
+            out << "D: " << key.d << "\n\n";
+            return out;
+        }
+    };
+
+    // Immutable public key (n, e), copies share one reference counted state and all operations are const and thread safe
+    template <class char_type = char, bool throw_errors = false>
+    class basic_public_key
+    {
+    private:
+        using rsa_t = basic_rsa<char_type, throw_errors>;
+        using string_view = std::basic_string_view<char_type>;
+
+        struct state_t
+        {
+            number_t n;
+            uint32_t e;
+            uint32_t bits;
+            bool utf8;
+            bool compress;
+        };
+
+        std::shared_ptr<const state_t> m_state;
+
+        _NODISCARD bool valid() const
+        {
+            if (m_state == nullptr) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("The public key is empty");
+                }
+                return false;
+            }
+            return true;
+        }
+
+    public:
+        basic_public_key() = default;
+
+        // n, e, the keysize that sets the block size of encrypt(), basic_rsa::set_utf8() and basic_rsa::set_compression()
+        basic_public_key(number_t _n, const uint32_t _e, const uint32_t _keysize, const bool _utf8 = false, const bool _compress = false)
+            : m_state(std::make_shared<const state_t>(state_t{ std::move(_n), _e, _keysize, _utf8, _compress }))
+        {
+
+        }
+
+        _NODISCARD explicit operator bool() const noexcept
+        {
+            return m_state != nullptr;
+        }
+
+        _NODISCARD const number_t& n() const noexcept
+        {
+            return m_state->n;
+        }
+
+        _NODISCARD uint32_t e() const noexcept
+        {
+            return m_state->e;
+        }
+
+        _NODISCARD uint32_t keysize() const noexcept
+        {
+            return m_state->bits;
+        }
+
+        // Encrypts a string
+        _NODISCARD std::vector<number_t> encrypt(const string_view& _str) const
+        {
+            if (!valid()) {
+                return { };
+            }
+
+            return rsa_t::encrypt_with(_str, m_state->e, m_state->n, m_state->bits, m_state->compress, detail::executor_settings::get().current());
+        }
+
+        // Encrypts many short messages at once (see basic_rsa::encrypt_batch())
+        _NODISCARD batch_t<number_t> encrypt_batch(const span<const string_view>& _messages) const
+        {
+            if (!valid()) {
+                return { };
+            }
+
+            return rsa_t::encrypt_batch_with(_messages, m_state->e, m_state->n, m_state->bits, detail::executor_settings::get().current());
+        }
+
+        // Encrypts a string into one packed_t buffer
+        _NODISCARD packed_t encrypt_packed(const string_view& _str) const
+        {
+            if (!valid()) {
+                return { };
+            }
+
+            return rsa_t::encrypt_packed_with(_str, m_state->e, m_state->n, m_state->bits, m_state->compress, detail::executor_settings::get().current());
+        }
+
+        // Encrypts a string with RSAES-OAEP
+        _NODISCARD std::vector<uint8_t> encrypt_oaep(const string_view& _str, const std::string_view& _label = { }) const
+        {
+            if (!valid()) {
+                return { };
+            }
+
+            return rsa_t::encrypt_oaep_with(_str, m_state->e, m_state->n, _label, m_state->utf8, detail::executor_settings::get().current());
+        }
+
+        // Encrypts a string with RSA-KEM and ChaCha20-Poly1305
+        _NODISCARD hybrid_t encrypt_hybrid(const string_view& _str) const
+        {
+            if (!valid()) {
+                return { };
+            }
+
+            return rsa_t::encrypt_hybrid_with(_str, m_state->e, m_state->n, m_state->utf8);
+        }
+
+        // Verifies a signature
+        _NODISCARD bool verify(const string_view& _str, const number_t& _signature) const
+        {
+            if (!valid()) {
+                return false;
+            }
+
+            return rsa_t::verify_with(_str, _signature, m_state->e, m_state->n);
+        }
+    };
+
+    // Immutable private key with the CRT parameters and the blinding pool, copies share one reference counted key
+    // and all operations are const and thread safe
+    template <class char_type = char, bool throw_errors = false>
+    class basic_private_key
+    {
+    private:
+        using rsa_t = basic_rsa<char_type, throw_errors>;
+        using string = std::basic_string<char_type>;
+        using string_view = std::basic_string_view<char_type>;
+
+        std::shared_ptr<const rsa_t> m_rsa;
+
+        _NODISCARD bool valid() const
+        {
+            if (m_rsa == nullptr) {
+                if constexpr (throw_errors) {
+                    throw std::invalid_argument("The private key is empty");
+                }
+                return false;
+            }
+            return true;
+        }
+
+    public:
+        basic_private_key() = default;
+
+        explicit basic_private_key(const rsa_t& _rsa) : m_rsa(std::make_shared<const rsa_t>(_rsa))
+        {
+
+        }
+
+        _NODISCARD explicit operator bool() const noexcept
+        {
+            return m_rsa != nullptr;
+        }
+
+        _NODISCARD basic_public_key<char_type, throw_errors> public_key() const
+        {
+            if (!valid()) {
+                return { };
+            }
+
+            return m_rsa->make_public_key();
+        }
+
+        // Decrypts the encrypted blocks, the blocks are left as they are
+        _NODISCARD string decrypt(const std::vector<number_t>& _encrypted) const
+        {
+            if (!valid()) {
+                return { };
+            }
+
+            return m_rsa->decrypt(_encrypted);
+        }
+
+        // Decrypts the encrypted blocks through a view, the blocks are left as they are
+        _NODISCARD string decrypt(const span<const number_t>& _encrypted) const
+        {
+            if (!valid()) {
+                return { };
+            }
+
+            return m_rsa->decrypt(_encrypted);
+        }
+
+        // Decrypts a packed_t
+        _NODISCARD string decrypt(const packed_t& _encrypted) const
+        {
+            if (!valid()) {
+                return { };
+            }
+
+            return m_rsa->decrypt(_encrypted);
+        }
+
+        // Decrypts fixed width big endian blocks
+        _NODISCARD string decrypt(const span<const uint8_t>& _blocks) const
+        {
+            if (!valid()) {
+                return { };
+            }
+
+            return m_rsa->decrypt(_blocks);
+        }
+
+        // Decrypts the result of encrypt_batch()
+        _NODISCARD batch_t<char_type> decrypt_batch(const batch_t<number_t>& _encrypted) const
+        {
+            if (!valid()) {
+                return { };
+            }
+
+            return m_rsa->decrypt_batch(_encrypted);
+        }
+
+        // Decrypts a hybrid ciphertext
+        _NODISCARD string decrypt(const hybrid_t& _encrypted) const
+        {
+            if (!valid()) {
+                return { };
+            }
+
+            return m_rsa->decrypt(_encrypted);
+        }
+
+        // Decrypts RSAES-OAEP blocks
+        _NODISCARD string decrypt_oaep(const std::vector<uint8_t>& _encrypted, const std::string_view& _label = { }) const
+        {
+            if (!valid()) {
+                return { };
+            }
+
+            return m_rsa->decrypt_oaep(_encrypted, _label);
+        }
+
+        // Signs a string
+        _NODISCARD number_t sign(const string_view& _str) const
+        {
+            if (!valid()) {
+                return 0;
+            }
+
+            return m_rsa->sign(_str);
+        }
+    };
+
+    // One key of a keystore, the public parts are read from the mapping without copying
+    class keystore_entry
+    {
+    private:
+        std::string_view m_id;
+        const uint8_t* m_key = nullptr;
+        size_t m_size = 0;
+
+        // Binary key offsets, see basic_rsa::export_binary()
+        constexpr static inline size_t BITS_OFFSET = 8;
+        constexpr static inline size_t E_OFFSET = 12;
+        constexpr static inline size_t FLAGS_OFFSET = 16;
+        constexpr static inline size_t LIMBS_OFFSET = 24;
+
+        // Limb count of n, its limbs follow directly (p and q come first in private keys)
+        _NODISCARD const uint8_t* modulus_record() const noexcept
+        {
+            if (m_size < MIN_SIZE) {
+                return nullptr;
+            }
+
+            const uint8_t* ptr = m_key + LIMBS_OFFSET;
+            const uint8_t* end = m_key + m_size - 8;
+
+            for (uint32_t i = 0; i < (has_private_key() ? 2 : 0); ++i)
+            {
+                if (end - ptr < 8 || detail::load_le64(ptr) > static_cast<uint64_t>(end - ptr - 8) / 8) {
+                    return nullptr;
+                }
+
+                ptr += 8 + detail::load_le64(ptr) * 8;
+            }
+
+            if (end - ptr < 8 || detail::load_le64(ptr) > static_cast<uint64_t>(end - ptr - 8) / 8) {
+                return nullptr;
+            }
+
+            return ptr;
+        }
+
+    public:
+        // Smallest binary key holding the header and a limb count
+        constexpr static inline size_t MIN_SIZE = LIMBS_OFFSET + 8;
+
+        keystore_entry(const std::string_view& _id, const uint8_t* _key, const size_t _size) noexcept : m_id(_id), m_key(_key), m_size(_size)
+        {
+
+        }
+
+        _NODISCARD std::string_view id() const noexcept
+        {
+            return m_id;
+        }
+
+        // The binary key of this entry
+        _NODISCARD const uint8_t* data() const noexcept
+        {
+            return m_key;
+        }
+
+        _NODISCARD size_t size() const noexcept
+        {
+            return m_size;
+        }
+
+        _NODISCARD uint32_t keysize() const noexcept
+        {
+            if (m_size < MIN_SIZE) {
+                return 0;
+            }
+
+            return detail::load_le32(m_key + BITS_OFFSET);
+        }
+
+        _NODISCARD uint32_t e() const noexcept
+        {
+            if (m_size < MIN_SIZE) {
+                return 0;
+            }
+
+            return detail::load_le32(m_key + E_OFFSET);
+        }
+
+        _NODISCARD bool has_private_key() const noexcept
+        {
+            if (m_size < MIN_SIZE) {
+                return false;
+            }
+
+            return (detail::load_le32(m_key + FLAGS_OFFSET) & 1) != 0;
+        }
+
+        // Little endian 64 bit limbs of n inside the mapping, 8 byte aligned
+        _NODISCARD const uint8_t* modulus_limbs() const noexcept
+        {
+            const uint8_t* record = modulus_record();
+            return record ? record + 8 : nullptr;
+        }
+
+        _NODISCARD size_t modulus_limb_count() const noexcept
+        {
+            const uint8_t* record = modulus_record();
+            return record ? static_cast<size_t>(detail::load_le64(record)) : 0;
+        }
+
+        // n as a number
+        _NODISCARD number_t modulus() const
+        {
+            number_t n;
+            const uint8_t* record = modulus_record();
+
+            if (record != nullptr) {
+                detail::read_limbs(record, m_key + m_size, n);
+            }
+
+            return n;
+        }
+    };
+
+    // Read only keystore: many binary keys in one memory mapped file with a hashed index from key id to record.
+    // Opening it only maps the file, keys are decoded when they are loaded and private parts on first use.
+    class keystore
+    {
+    public:
+        // "RSAS", version, reserved, bucket count, key count, then the index of (id hash, record offset) buckets
+        // with linear probing and the records: id size, reserved, key size, id and binary key, each padded to 8 bytes
+        constexpr static inline char MAGIC[4] = { 'R', 'S', 'A', 'S' };
+        constexpr static inline uint32_t VERSION = 1;
+        constexpr static inline size_t HEADER = 32;
+        constexpr static inline size_t BUCKET = 16;
+        constexpr static inline size_t RECORD = 16;
+
+    private:
+        std::shared_ptr<const detail::mapped_file> m_file;
+        uint64_t m_buckets = 0;
+        uint64_t m_count = 0;
+
+    public:
+        keystore() = default;
+
+        explicit keystore(const std::string_view& _filename)
+        {
+            open(_filename);
+        }
+
+        // Map a keystore file
+        bool open(const std::string_view& _filename)
+        {
+            m_file.reset();
+            m_buckets = m_count = 0;
+
+            auto _file = std::make_shared<detail::mapped_file>();
+
+            if (!_file->open(_filename) || _file->size() < HEADER || std::memcmp(_file->data(), MAGIC, sizeof(MAGIC)) != 0) {
+                return false;
+            }
+
+            const uint64_t buckets = detail::load_le64(_file->data() + 8);
+
+            if (detail::load_le32(_file->data() + 4) != VERSION || buckets == 0 || (buckets & (buckets - 1)) != 0 || buckets > (_file->size() - HEADER) / BUCKET) {
+                return false;
+            }
+
+            m_buckets = buckets;
+            m_count = detail::load_le64(_file->data() + 16);
+            m_file = std::move(_file);
+
+            return true;
+        }
+
+        _NODISCARD explicit operator bool() const noexcept
+        {
+            return m_file != nullptr;
+        }
+
+        // Amount of keys in the keystore
+        _NODISCARD size_t size() const noexcept
+        {
+            return static_cast<size_t>(m_count);
+        }
+
+        // Find a key by id
+        _NODISCARD std::optional<keystore_entry> find(const std::string_view& _id) const noexcept
+        {
+            if (!m_file) {
+                return std::nullopt;
+            }
+
+            const uint8_t* base = m_file->data();
+            const size_t size = m_file->size();
+            const uint64_t hash = detail::fnv1a64(reinterpret_cast<const uint8_t*>(_id.data()), _id.size());
+
+            for (uint64_t i = 0; i < m_buckets; ++i)
+            {
+                const uint8_t* bucket = base + HEADER + ((hash + i) & (m_buckets - 1)) * BUCKET;
+                const uint64_t offset = detail::load_le64(bucket + 8);
+
+                if (offset == 0) {
+                    break;
+                }
+
+                if (detail::load_le64(bucket) != hash || offset > size - RECORD) {
+                    continue;
                 }
 
-                msg.append( std::to_string(num.size()) );
+                const uint64_t id_size = detail::load_le32(base + offset);
+                const uint64_t key_size = detail::load_le64(base + offset + 8);
+                const uint64_t key_offset = offset + RECORD + padded(id_size);
 
-                if (negative) {
-                    msg.push_back('0');
-                    msg.append(num.substr(1));
-                }
-                else {
-                    msg.append(num);
+                if (key_offset > size || key_size > size - key_offset || key_size < keystore_entry::MIN_SIZE || id_size != _id.size()) {
+                    continue;
                 }
 
-                if (++i == _str.size()) {
-                    msg.push_back('0');
-                    if (!push_block()) {
-                        continue;
-                    }
-                    else {
-                        break;
-                    }
+                if (std::memcmp(base + offset + RECORD, _id.data(), _id.size()) == 0) {
+                    return keystore_entry(std::string_view(reinterpret_cast<const char*>(base + offset + RECORD), id_size), base + key_offset, key_size);
                 }
             }
 
-            return blocks;
+            return std::nullopt;
         }
 
-        // Calculate the extended Euclidean algorithm
-        _NODISCARD static number_t egcd(const number_t& a, const number_t& b, number_t& x, number_t& y) noexcept
+        // Find a key by its modulus fingerprint
+        _NODISCARD std::optional<keystore_entry> find(const number_t& _n) const
         {
-            if (a == 0) {
-                x = 0;
-                y = 1;
-                return b;
+            return find(fingerprint(_n));
+        }
+
+        // Load a key into a basic_rsa, its members are public so the private parts are decoded right away
+        template <class rsa_t>
+        bool load(const std::string_view& _id, rsa_t& _rsa) const
+        {
+            const auto entry = find(_id);
+
+            return entry && _rsa.import_binary(entry->data(), entry->size());
+        }
+
+        // Load a private key, only n and e are decoded now and the private parts by the first private key operation,
+        // empty if the id is unknown or the key has no private parts
+        template <class char_type = char, bool throw_errors = false>
+        _NODISCARD basic_private_key<char_type, throw_errors> load_private_key(const std::string_view& _id) const
+        {
+            const auto entry = find(_id);
+
+            basic_rsa<char_type, throw_errors> rsa;
+
+            if (!entry || !rsa.import_binary(m_file, entry->data(), entry->size()) || !rsa.has_private_key()) {
+                return { };
             }
-            
-            number_t x1, y1;
-            number_t gcd = egcd(b % a, a, x1, y1);
 
-            x = y1 - (b / a) * x1;
-            y = x1;
+            return basic_private_key<char_type, throw_errors>(rsa);
+        }
 
-            return gcd;
-        };
+        // Key id from the modulus: hex SHA-256 of n
+        _NODISCARD static std::string fingerprint(const number_t& _n)
+        {
+            constexpr char hex[] = "0123456789abcdef";
 
-        // Calculate modular multiplicative inverse of e and phi
-        _NODISCARD static number_t inverse_mod(const number_t& e, const number_t& phi) noexcept
+            std::string result;
+
+            for (const uint8_t byte : detail::key_fingerprint(_n)) {
+                result.push_back(hex[byte >> 4]);
+                result.push_back(hex[byte & 0xf]);
+            }
+
+            return result;
+        }
+
+        _NODISCARD static constexpr uint64_t padded(const uint64_t _size) noexcept
         {
-            number_t x = 0, y = 0;
-            if (egcd(e, phi, x, y) == 1) {
-                return ((x % phi) + phi) % phi;
+            return (_size + 7) & ~uint64_t(7);
+        }
+    };
+
+    // Builds a keystore file
+    class keystore_writer
+    {
+    private:
+        std::vector<std::pair<std::string, std::vector<uint8_t>>> m_keys;
+        std::unordered_set<std::string> m_ids;
+
+    public:
+        // Add a binary key (see basic_rsa::export_binary()), false if the id is already used
+        bool add_binary(const std::string_view& _id, std::vector<uint8_t> _key)
+        {
+            if (_id.size() > std::numeric_limits<uint32_t>::max() || !m_ids.emplace(_id).second) {
+                return false;
             }
-            return 0;
+
+            m_keys.emplace_back(std::string(_id), std::move(_key));
+
+            return true;
         }
 
-        // Generate random primelike string with X bits
-        _NODISCARD static std::string random_primish_number(const uint32_t _bits) noexcept
+        // Add a key with an id
+        template <class rsa_t>
+        bool add(const std::string_view& _id, const rsa_t& _rsa)
         {
-            std::mt19937_64 gen(std::random_device{ }());
-            std::uniform_int_distribution<int32_t> dist('0', '9');
+            return add_binary(_id, _rsa.export_binary());
+        }
 
-            const uint32_t bytes = _bits / 8;
+        // Add a key with its modulus fingerprint as id
+        template <class rsa_t>
+        bool add(const rsa_t& _rsa)
+        {
+            return add_binary(keystore::fingerprint(_rsa.n), _rsa.export_binary());
+        }
 
-            std::string str(bytes, 0);
+        // Write the keystore file
+        bool write(const std::string_view& _filename) const
+        {
+            // At most half of the buckets are used, so probe sequences stay short
+            uint64_t buckets = 1;
 
-            for (char& ch : str) {
-                ch = static_cast<char>(dist(gen));
+            while (buckets < m_keys.size() * 2) {
+                buckets *= 2;
             }
 
-            while (str.front() == '0') {
-                str.front() = static_cast<char>(dist(gen));
+            std::vector<uint8_t> data(keystore::HEADER + buckets * keystore::BUCKET, 0);
+
+            std::memcpy(data.data(), keystore::MAGIC, sizeof(keystore::MAGIC));
+            detail::store_le32(data.data() + 4, keystore::VERSION);
+            detail::store_le64(data.data() + 8, buckets);
+            detail::store_le64(data.data() + 16, m_keys.size());
+
+            for (const auto& [id, key] : m_keys)
+            {
+                const uint64_t offset = data.size();
+                const uint64_t hash = detail::fnv1a64(reinterpret_cast<const uint8_t*>(id.data()), id.size());
+
+                data.resize(offset + keystore::RECORD + keystore::padded(id.size()) + keystore::padded(key.size()), 0);
+
+                detail::store_le32(data.data() + offset, static_cast<uint32_t>(id.size()));
+                detail::store_le64(data.data() + offset + 8, key.size());
+                std::memcpy(data.data() + offset + keystore::RECORD, id.data(), id.size());
+                std::memcpy(data.data() + offset + keystore::RECORD + keystore::padded(id.size()), key.data(), key.size());
+
+                uint64_t bucket = hash & (buckets - 1);
+
+                while (detail::load_le64(data.data() + keystore::HEADER + bucket * keystore::BUCKET + 8) != 0) {
+                    bucket = (bucket + 1) & (buckets - 1);
+                }
+
+                detail::store_le64(data.data() + keystore::HEADER + bucket * keystore::BUCKET, hash);
+                detail::store_le64(data.data() + keystore::HEADER + bucket * keystore::BUCKET + 8, offset);
             }
 
-            while (str.back() != '1' && str.back() != '3' && str.back() != '7' && str.back() != '9') {
-                str.back() = static_cast<char>(dist(gen));
+            std::ofstream _file(std::string(_filename), std::ios::binary);
+
+            if (_file.good() == false) {
+                return false;
             }
 
-            return str;
+            _file.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+            return _file.good();
         }
+    };
 
-        // Generate 2 primes p and q
-        _NODISCARD static std::pair<number_t, number_t> generate_prime_pair(const uint32_t _bits, const uint32_t _trys) noexcept
+    // Ciphertext container header: "RSAC", version, block size, reserved, block count and the key fingerprint,
+    // the blocks follow as fixed width big endian numbers
+    struct ciphertext_header
+    {
+        constexpr static inline char MAGIC[4] = { 'R', 'S', 'A', 'C' };
+        constexpr static inline uint32_t VERSION = 1;
+        constexpr static inline size_t SIZE = 56;
+
+        uint32_t block_size = 0;
+        uint64_t block_count = 0;
+        std::array<uint8_t, 32> fingerprint{ };
+
+        ciphertext_header() = default;
+
+        ciphertext_header(const number_t& _n, const uint64_t _count) : block_size(static_cast<uint32_t>(detail::byte_length(_n))), block_count(_count), fingerprint(detail::key_fingerprint(_n))
         {
-            auto search_thread = [_trys](const uint32_t bits, number_t& X, std::mutex& lock) noexcept -> void
-            {
-                number_t possible_prime;
 
-                while (X.is_zero())
-                {
-                    possible_prime.assign(random_primish_number(bits));
+        }
 
-                    if (is_prime(possible_prime, _trys))
-                    {
-                        lock.lock();
-                        {
-                            if (X.is_zero())
-                                X = possible_prime;
-                        }
-                        lock.unlock();
+        // True if the blocks belong to the key with modulus X
+        _NODISCARD bool matches(const number_t& _n) const
+        {
+            return fingerprint == detail::key_fingerprint(_n);
+        }
 
-                        return;
-                    }
-                }
-            };
+        _NODISCARD std::array<uint8_t, SIZE> serialize() const noexcept
+        {
+            std::array<uint8_t, SIZE> data{ };
 
-            static const uint32_t threads_per = thread_count / 2;
+            std::memcpy(data.data(), MAGIC, sizeof(MAGIC));
+            detail::store_le32(data.data() + 4, VERSION);
+            detail::store_le32(data.data() + 8, block_size);
+            detail::store_le64(data.data() + 16, block_count);
+            std::memcpy(data.data() + 24, fingerprint.data(), fingerprint.size());
 
-            number_t p = 0, q = 0;
+            return data;
+        }
 
-            std::mt19937_64 mt(std::random_device{ }());
-            std::uniform_int_distribution<int32_t> dist(((_bits / 64) * -1) - 8, (_bits / 64) + 8);
+        // Parse and check a header, false if it isn`t one
+        _NODISCARD bool parse(const uint8_t* _data, const size_t _size) noexcept
+        {
+            if (_size < SIZE || std::memcmp(_data, MAGIC, sizeof(MAGIC)) != 0 || detail::load_le32(_data + 4) != VERSION || detail::load_le32(_data + 8) == 0) {
+                return false;
+            }
 
-            const int32_t _SP = _bits + dist(mt), _SQ = _bits + dist(mt);
+            block_size = detail::load_le32(_data + 8);
+            block_count = detail::load_le64(_data + 16);
+            std::memcpy(fingerprint.data(), _data + 24, fingerprint.size());
 
-            std::mutex p_lock;
-            std::mutex q_lock;
+            return true;
+        }
+    };
+
+    // Writes a ciphertext container to a stream block by block
+    class ciphertext_writer
+    {
+    private:
+        std::ostream& m_out;
+        ciphertext_header m_header;
+        std::vector<uint8_t> m_buffer;
+        uint64_t m_written = 0;
 
-            std::vector<std::future<void>> threads;
+    public:
+        ciphertext_writer(std::ostream& _out, const number_t& _n, const uint64_t _count) : m_out(_out), m_header(_n, _count), m_buffer(m_header.block_size)
+        {
+            const auto header = m_header.serialize();
+            m_out.write(reinterpret_cast<const char*>(header.data()), header.size());
+        }
 
-            for (uint32_t i = 0; i < threads_per; ++i) {
-                threads.push_back(std::async(std::launch::async, search_thread, _SP, std::ref(p), std::ref(p_lock)));
-                threads.push_back(std::async(std::launch::async, search_thread, _SQ, std::ref(q), std::ref(q_lock)));
+        // Append one block, false if it doesn`t fit the block size or all blocks are written
+        bool write(const number_t& _block)
+        {
+            if (m_written == m_header.block_count || !detail::to_bytes(_block, m_buffer.data(), m_buffer.size())) {
+                return false;
             }
 
-            for (const auto& thread : threads) {
-                thread.wait();
+            m_out.write(reinterpret_cast<const char*>(m_buffer.data()), m_buffer.size());
+            ++m_written;
+
+            return m_out.good();
+        }
+
+        bool write(const std::vector<number_t>& _blocks)
+        {
+            for (const auto& block : _blocks) {
+                if (!write(block)) {
+                    return false;
+                }
             }
 
-            return std::make_pair(std::move(p), std::move(q));
+            return true;
         }
 
-        // Miller Rabin test num X with Y tests
-        _NODISCARD static bool miller_rabin(const number_t& _num, const uint32_t _trys) noexcept
+        // True if all blocks announced in the header are written
+        _NODISCARD bool complete() const
         {
-            const number_t d_base = _num - 1;
-            number_t d = d_base;
+            return m_written == m_header.block_count && m_out.good();
+        }
 
-            uint32_t _divides = 0;
-            while (d % 2 == 0) {
-                d /= 2;
-                ++_divides;
+        // Write a whole ciphertext to a file
+        static bool save(const std::string_view& _filename, const number_t& _n, const std::vector<number_t>& _blocks)
+        {
+            std::ofstream _file(std::string(_filename), std::ios::binary);
+
+            if (_file.good() == false) {
+                return false;
             }
 
-            std::mt19937_64 mt(std::random_device{ }());
-            boost::random::uniform_int_distribution<number_t> dist(2, _num - 2);
+            ciphertext_writer writer(_file, _n, _blocks.size());
 
-            for (uint32_t i = 0; i < _trys; ++i)
-            {
-                const number_t rand = dist(mt);
-                number_t x = boost::multiprecision::powm(rand, d, _num);
+            return writer.write(_blocks) && writer.complete();
+        }
+    };
 
-                if (x == 1 || x == d_base)
-                    continue;
+    // Reads a ciphertext container from a stream block by block
+    class ciphertext_reader
+    {
+    private:
+        std::istream& m_in;
+        ciphertext_header m_header;
+        std::vector<uint8_t> m_buffer;
+        uint64_t m_read = 0;
+        bool m_valid = false;
 
-                bool not_prime = true;
+    public:
+        explicit ciphertext_reader(std::istream& _in) : m_in(_in)
+        {
+            std::array<uint8_t, ciphertext_header::SIZE> header{ };
 
-                for (uint32_t j = 1; j < _divides; ++j)
-                {
-                    x = (x * x) % _num;
+            if (m_in.read(reinterpret_cast<char*>(header.data()), header.size()) && m_header.parse(header.data(), header.size())) {
+                m_buffer.resize(m_header.block_size);
+                m_valid = true;
+            }
+        }
 
-                    if (x == d_base) {
-                        not_prime = false;
-                        break;
-                    }
-                }
+        _NODISCARD explicit operator bool() const noexcept
+        {
+            return m_valid;
+        }
 
-                if (not_prime)
-                    return false;
+        _NODISCARD const ciphertext_header& header() const noexcept
+        {
+            return m_header;
+        }
+
+        // Read the next block, false at the end or on a short read
+        bool next(number_t& _block)
+        {
+            if (!m_valid || m_read == m_header.block_count) {
+                return false;
             }
 
+            if (!m_in.read(reinterpret_cast<char*>(m_buffer.data()), m_buffer.size())) {
+                m_valid = false;
+                return false;
+            }
+
+            _block = detail::from_bytes(m_buffer.data(), m_buffer.size());
+            ++m_read;
+
             return true;
         }
 
-        // Check if X number is prime with Y Miller Rabin tests
-        _NODISCARD static bool is_prime(const number_t& _num, const uint32_t _trys) noexcept
+        // Read all remaining blocks, empty if the stream ends early
+        _NODISCARD std::vector<number_t> read_all()
         {
-            if (_num == 2 || _num == 3)
-                return true;
+            std::vector<number_t> blocks;
+            number_t block;
 
-            if (_num <= 1 || _num % 2 == 0 || _num % 3 == 0)
+            while (next(block)) {
+                blocks.push_back(block);
+            }
+
+            if (m_read != m_header.block_count) {
+                return { };
+            }
+
+            return blocks;
+        }
+    };
+
+    // Memory mapped ciphertext container, blocks() can be passed to basic_rsa::decrypt() as is
+    class ciphertext_file
+    {
+    private:
+        detail::mapped_file m_file;
+        ciphertext_header m_header;
+
+    public:
+        ciphertext_file() = default;
+
+        explicit ciphertext_file(const std::string_view& _filename)
+        {
+            open(_filename);
+        }
+
+        // Map a ciphertext file, false if it isn`t a complete container
+        bool open(const std::string_view& _filename)
+        {
+            m_header = { };
+
+            if (!m_file.open(_filename) || !m_header.parse(m_file.data(), m_file.size())) {
+                m_file.close();
                 return false;
+            }
 
-            for (uint64_t i = 5; i < 1000; i += 6) {
-                if (_num % i == 0 || _num % (i + 2) == 0)
-                    return false;
+            if (m_header.block_count > (m_file.size() - ciphertext_header::SIZE) / m_header.block_size) {
+                m_file.close();
+                m_header = { };
+                return false;
             }
 
-            return miller_rabin(_num, _trys);
+            return true;
         }
 
-        // Get a good amouth of Miller Rabin test for X bits
-        _NODISCARD static uint32_t get_rabin_trys(const uint64_t _bits) noexcept
+        _NODISCARD explicit operator bool() const noexcept
         {
-            return static_cast<uint32_t>(2 + std::log2(std::sqrt(_bits)) * 3.0);
+            return static_cast<bool>(m_file);
         }
 
-        // Output for RSA class
-        template<class _char, bool _throw, class ostream = std::ostream>
-        friend ostream& operator<<(ostream& out, const basic_rsa<_char, _throw>& rsa)
+        _NODISCARD const ciphertext_header& header() const noexcept
         {
-            out << "Charset  : " << typeid(_char).name() << '\n';
-            out << "Keysize  : " << rsa.keysize() << '\n';
-            out << "Trys     : " << rsa.trys() << '\n';
-            out << "Precision: " << rsa.precision() << '%' << '\n';
-            out << "Setupdone: " << (rsa.setupdone() == true ? "true" : "false") << "\n\n";
-            out << "P: " << rsa.p << "\n\n";
-            out << "Q: " << rsa.q << "\n\n";
-            out << "N: " << rsa.n << "\n\n";
-            out << "E: " << rsa.e << "\n\n";
-            out << "D: " << rsa.d << "\n\n";
-            return out;
+            return m_header;
+        }
+
+        // All blocks inside the mapping
+        _NODISCARD span<const uint8_t> blocks() const noexcept
+        {
+            if (!m_file) {
+                return { };
+            }
+
+            return span<const uint8_t>(m_file.data() + ciphertext_header::SIZE, static_cast<size_t>(m_header.block_count * m_header.block_size));
+        }
+
+        // Block X inside the mapping
+        _NODISCARD span<const uint8_t> block(const size_t _index) const noexcept
+        {
+            return blocks().subspan(_index * m_header.block_size, m_header.block_size);
         }
     };
 }